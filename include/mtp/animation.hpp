@@ -0,0 +1,225 @@
+#ifndef ANIMATION_HPP
+#define ANIMATION_HPP
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "vector.hpp"
+#include "quat.hpp"
+#include "parallel.hpp"
+
+namespace mtp {
+
+/* How values between two keys are produced. */
+enum class key_interpolation {
+    step,   /* value of the previous key */
+    linear, /* lerp, nlerp for quaternions */
+    cubic,  /* cubic Hermite with per-key in/out tangents (units per second) */
+    slerp   /* spherical interpolation for quaternions, linear for everything else */
+};
+
+/*
+* Remembers the key interval of the last sample. Mostly monotonic playback finds the next
+* interval in O(1), jumps fall back to a binary search. One cursor per track and sampler.
+*/
+struct keyframe_cursor {
+    std::size_t key = 0;
+};
+
+namespace detail {
+
+template <typename T>
+inline T key_lerp(const T &a, const T &b, const float &t) {
+    return T(a + (b - a) * t);
+}
+
+inline quat key_lerp(const quat &a, const quat &b, const float &t) {
+    return nlerp(a, b, t);
+}
+
+template <typename T>
+inline T key_slerp(const T &a, const T &b, const float &t) {
+    return key_lerp(a, b, t);
+}
+
+inline quat key_slerp(const quat &a, const quat &b, const float &t) {
+    return slerp(a, b, t);
+}
+
+/* Hermite basis: p0, p1 values, m0, m1 tangents scaled by the interval length dt. */
+template <typename T>
+inline T key_hermite(const T &p0, const T &m0, const T &p1, const T &m1, const float &t, const float &dt) {
+    const float t2 = t*t, t3 = t2*t;
+    const float h00 = 2.0f*t3 - 3.0f*t2 + 1.0f;
+    const float h10 = (t3 - 2.0f*t2 + t) * dt;
+    const float h01 = -2.0f*t3 + 3.0f*t2;
+    const float h11 = (t3 - t2) * dt;
+    return T(p0*h00 + m0*h10 + p1*h01 + m1*h11);
+}
+
+inline quat key_hermite(const quat &p0, const quat &m0, const quat &p1, const quat &m1, const float &t, const float &dt) {
+    const float t2 = t*t, t3 = t2*t;
+    return normalize(p0*(2.0f*t3 - 3.0f*t2 + 1.0f) + m0*((t3 - 2.0f*t2 + t) * dt) + p1*(-2.0f*t3 + 3.0f*t2) + m1*((t3 - t2) * dt));
+}
+
+/* Tracks per parallel chunk */
+constexpr std::size_t track_grain = 512;
+
+}
+
+/**
+* @brief Timestamped keys of one animated value, stored as separate time, value and tangent arrays.
+* Times must increase. Sampling before the first or after the last key returns that key.
+* @arg T - scalar, vector<T, N> or quat.
+*/
+template <typename T>
+struct keyframe_track {
+    key_interpolation mode = key_interpolation::linear;
+    std::vector<float> times;
+    std::vector<T> values;
+    std::vector<T> in_tangents;  /* cubic only */
+    std::vector<T> out_tangents; /* cubic only */
+
+    keyframe_track()
+    {
+
+    }
+
+    explicit keyframe_track(const key_interpolation &mode) : mode(mode)
+    {
+
+    }
+
+    inline std::size_t size() const { return times.size(); }
+    inline bool empty() const { return times.empty(); }
+
+    inline float start_time() const { return times.empty() ? 0.0f : times.front(); }
+    inline float end_time() const { return times.empty() ? 0.0f : times.back(); }
+
+    void reserve(const std::size_t &keys) {
+        times.reserve(keys);
+        values.reserve(keys);
+        if(mode == key_interpolation::cubic) {
+            in_tangents.reserve(keys);
+            out_tangents.reserve(keys);
+        }
+    }
+
+    /* Appends a key, cubic tracks get zero tangents until compute_tangents() or the overload below. */
+    void add(const float &time, const T &value) {
+        times.push_back(time);
+        values.push_back(value);
+        if(mode == key_interpolation::cubic) {
+            in_tangents.push_back(key_zero());
+            out_tangents.push_back(key_zero());
+        }
+    }
+
+    void add(const float &time, const T &value, const T &in_tangent, const T &out_tangent) {
+        times.push_back(time);
+        values.push_back(value);
+        in_tangents.push_back(in_tangent);
+        out_tangents.push_back(out_tangent);
+    }
+
+    /* Catmull-Rom style tangents from the neighbouring keys (one-sided at the ends). */
+    void compute_tangents() {
+        const std::size_t n = times.size();
+        in_tangents.resize(n);
+        out_tangents.resize(n);
+        for(std::size_t k = 0; k < n; k++) {
+            const std::size_t a = k ? k - 1 : k, b = k + 1 < n ? k + 1 : k;
+            const float dt = times[b] - times[a];
+            const T tangent = dt > 0.0f ? T((values[b] - values[a]) * (1.0f / dt)) : key_zero();
+            in_tangents[k] = out_tangents[k] = tangent;
+        }
+    }
+
+    /**
+    * @brief Index k of the interval times[k] <= time < times[k+1], clamped to [0, size-2].
+    */
+    inline std::size_t find(const float &time) const {
+        if(times.size() < 2) return 0;
+        const std::size_t k = static_cast<std::size_t>(std::upper_bound(times.begin(), times.end(), time) - times.begin());
+        return std::min(k ? k - 1 : 0, times.size() - 2);
+    }
+
+    /* find() starting from the cursor, O(1) while the time moves forward by less than a key. */
+    inline std::size_t find(const float &time, keyframe_cursor &cursor) const {
+        const std::size_t n = times.size();
+        if(n < 2) return 0;
+        std::size_t k = std::min(cursor.key, n - 2);
+        if(time >= times[k]) {
+            if(time < times[k+1] || k == n - 2) return cursor.key = k;
+            if(time < times[k+2]) return cursor.key = k + 1;
+        } else if(k == 0) {
+            return cursor.key = 0;
+        }
+        return cursor.key = find(time);
+    }
+
+    /* Samples with a binary search. */
+    inline T sample(const float &time) const {
+        return evaluate(find(time), time);
+    }
+
+    /* Samples through the cursor. */
+    inline T sample(const float &time, keyframe_cursor &cursor) const {
+        return evaluate(find(time, cursor), time);
+    }
+
+    /* Value of interval k at time. */
+    T evaluate(const std::size_t &k, const float &time) const {
+        if(times.size() < 2) return times.empty() ? key_zero() : values[0];
+        if(time <= times[k]) return values[k];
+        if(time >= times[k+1]) return values[k+1];
+
+        const float dt = times[k+1] - times[k];
+        const float t = (time - times[k]) / dt;
+        switch(mode) {
+            case key_interpolation::step:  return values[k];
+            case key_interpolation::cubic: return detail::key_hermite(values[k], out_tangents[k], values[k+1], in_tangents[k+1], t, dt);
+            case key_interpolation::slerp: return detail::key_slerp(values[k], values[k+1], t);
+            default:                       return detail::key_lerp(values[k], values[k+1], t);
+        }
+    }
+
+private:
+    static inline T key_zero() {
+        if constexpr(std::is_same_v<T, quat>) return quat{0.0f, 0.0f, 0.0f, 0.0f};
+        else return T(0);
+    }
+};
+
+/**
+* @brief Samples many tracks at one time point.
+* @param cursors one cursor per track (kept between calls for O(1) playback), may be nullptr
+* @param parallel splits the tracks between hardware threads
+*/
+template <typename T>
+void sample_tracks(const keyframe_track<T>* tracks, const std::size_t &count, const float &time, T* out,
+    keyframe_cursor* cursors = nullptr, const bool &parallel = true)
+{
+    MTP_PROFILE_OP(interpolation, count, 0);
+    parallel_for_chunks(plan_chunks(count, detail::track_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        if(cursors) {
+            for(std::size_t i = begin; i < end; i++) out[i] = tracks[i].sample(time, cursors[i]);
+        } else {
+            for(std::size_t i = begin; i < end; i++) out[i] = tracks[i].sample(time);
+        }
+    });
+}
+
+template <typename T>
+void sample_tracks(const std::vector<keyframe_track<T>> &tracks, const float &time, std::vector<T> &out,
+    std::vector<keyframe_cursor>* cursors = nullptr, const bool &parallel = true)
+{
+    out.resize(tracks.size());
+    if(cursors) cursors->resize(tracks.size());
+    sample_tracks(tracks.data(), tracks.size(), time, out.data(), cursors ? cursors->data() : nullptr, parallel);
+}
+
+}
+
+#endif
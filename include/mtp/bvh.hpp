@@ -0,0 +1,598 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "vector.hpp"
+#include "parallel.hpp"
+
+namespace mtp {
+
+/**
+* @brief Flattened BVH node (32 bytes for float).
+* Inner nodes: count == 0, children are nodes first and first+1.
+* Leaves: primitives [first, first+count) of bvh::indices.
+*/
+template <typename T>
+struct bvh_node {
+    T min[3];
+    std::uint32_t first;
+    T max[3];
+    std::uint32_t count;
+
+    inline bool leaf() const { return count != 0; }
+};
+
+template <typename T>
+struct bvh_ray {
+    vector3<T> origin;
+    vector3<T> direction;
+    T t_min = T(0);
+    T t_max = std::numeric_limits<T>::infinity();
+};
+
+static constexpr std::uint32_t bvh_invalid = std::numeric_limits<std::uint32_t>::max();
+
+template <typename T>
+struct bvh_hit {
+    std::uint32_t primitive = bvh_invalid;
+    T t = std::numeric_limits<T>::infinity();
+};
+
+template <typename T>
+struct bvh_nearest {
+    std::uint32_t primitive = bvh_invalid;
+    T distance2 = std::numeric_limits<T>::infinity(); /* squared distance */
+};
+
+/**
+* @brief Bounding volume hierarchy over primitive bounds, built with binned SAH.
+*
+* Nodes are stored depth-first in one array with sibling pairs side by side, so a child index is
+* always greater than its parent index (refit walks the array backwards). Primitive bounds are kept
+* in leaf order next to the index permutation to keep leaf tests on contiguous memory.
+*/
+template <typename T>
+struct bvh {
+    std::vector<bvh_node<T>> nodes;
+    std::vector<std::uint32_t> indices; /* leaf order -> primitive id */
+    std::vector<vector3<T>> prim_min;   /* bounds in leaf order */
+    std::vector<vector3<T>> prim_max;
+
+    static constexpr std::size_t bins = 16;
+    static constexpr std::size_t max_stack = 128; /* also limits the depth of the tree */
+
+    std::size_t max_leaf_size = 4;
+    T traversal_cost = T(1); /* SAH cost of visiting a node relative to one primitive test */
+
+    /**
+    * @brief Builds the hierarchy.
+    * @param min_bounds primitive box minima
+    * @param max_bounds primitive box maxima
+    * @param count number of primitives
+    * @param parallel builds large subtrees and binning passes on worker threads
+    */
+    void build(const vector3<T>* min_bounds, const vector3<T>* max_bounds, const std::size_t &count, const bool &parallel = true) {
+        nodes.clear();
+        indices.resize(count);
+        prim_min.resize(count);
+        prim_max.resize(count);
+        if(count == 0) return;
+
+        builder b(*this, min_bounds, max_bounds, parallel);
+        nodes.resize(2*count - 1);
+        b.node_count.store(1);
+        b.build(0, 0, count, b.bounds(0, count, parallel), 0);
+        nodes.resize(b.node_count.load());
+        for(std::size_t i = 0; i < count; i++) indices[i] = b.refs[i].index;
+
+        for(std::size_t i = 0; i < count; i++) {
+            prim_min[i] = min_bounds[indices[i]];
+            prim_max[i] = max_bounds[indices[i]];
+        }
+    }
+
+    /**
+    * @brief Updates node bounds after the primitives moved. The topology is kept.
+    */
+    void refit(const vector3<T>* min_bounds, const vector3<T>* max_bounds) {
+        for(std::size_t i = 0; i < indices.size(); i++) {
+            prim_min[i] = min_bounds[indices[i]];
+            prim_max[i] = max_bounds[indices[i]];
+        }
+
+        for(std::size_t i = nodes.size(); i-- > 0;) {
+            bvh_node<T> &node = nodes[i];
+            if(node.leaf()) {
+                set_bounds(node, node.first, node.first + node.count);
+            } else {
+                const bvh_node<T> &l = nodes[node.first];
+                const bvh_node<T> &r = nodes[node.first + 1];
+                for(std::size_t a = 0; a < 3; a++) {
+                    node.min[a] = std::min(l.min[a], r.min[a]);
+                    node.max[a] = std::max(l.max[a], r.max[a]);
+                }
+            }
+        }
+    }
+
+    /**
+    * @brief Closest hit along a ray.
+    * @param hit bool(primitive, ray, t) - exact primitive test, on a hit stores the distance in t
+    */
+    template <typename Hit>
+    bvh_hit<T> intersect(const bvh_ray<T> &ray, Hit&& hit) const {
+        return traverse_ray(ray, [&](const std::size_t &slot, const T*, const T*, const T &t_max, T &t) {
+            t = t_max;
+            return hit(indices[slot], ray, t);
+        });
+    }
+
+    /**
+    * @brief Closest hit along a ray against the primitive boxes.
+    */
+    bvh_hit<T> intersect(const bvh_ray<T> &ray) const {
+        return traverse_ray(ray, [&](const std::size_t &slot, const T* org, const T* inv, const T &t_max, T &t) {
+            const T pmin[3] = {prim_min[slot].x, prim_min[slot].y, prim_min[slot].z};
+            const T pmax[3] = {prim_max[slot].x, prim_max[slot].y, prim_max[slot].z};
+            return slab(pmin, pmax, org, inv, ray.t_min, t_max, t);
+        });
+    }
+
+    /**
+    * @brief Nearest primitive to a point.
+    * @param distance2 T(primitive, point) - exact squared distance to a primitive
+    * @param max_distance2 search radius (squared)
+    */
+    template <typename Distance, typename = std::enable_if_t<!std::is_arithmetic_v<std::decay_t<Distance>>>>
+    bvh_nearest<T> nearest(const vector3<T> &point, Distance&& distance2, const T &max_distance2 = std::numeric_limits<T>::infinity()) const {
+        return traverse_nearest(point, max_distance2, [&](const std::size_t &slot, const T*) {
+            return distance2(indices[slot], point);
+        });
+    }
+
+    /**
+    * @brief Nearest primitive box to a point (exact for point primitives).
+    */
+    bvh_nearest<T> nearest(const vector3<T> &point, const T &max_distance2 = std::numeric_limits<T>::infinity()) const {
+        return traverse_nearest(point, max_distance2, [&](const std::size_t &slot, const T* p) {
+            const T pmin[3] = {prim_min[slot].x, prim_min[slot].y, prim_min[slot].z};
+            const T pmax[3] = {prim_max[slot].x, prim_max[slot].y, prim_max[slot].z};
+            return box_distance2(pmin, pmax, p);
+        });
+    }
+
+    /**
+    * @brief Calls visit(primitive) for every primitive whose box overlaps [box_min, box_max].
+    */
+    template <typename Visit>
+    void query(const vector3<T> &box_min, const vector3<T> &box_max, Visit&& visit) const {
+        if(nodes.empty()) return;
+
+        const T lo[3] = {box_min.x, box_min.y, box_min.z};
+        const T hi[3] = {box_max.x, box_max.y, box_max.z};
+        std::uint32_t stack[max_stack];
+        std::size_t top = 0;
+        stack[top++] = 0;
+
+        while(top) {
+            const bvh_node<T> &node = nodes[stack[--top]];
+            if(!overlaps(node.min, node.max, lo, hi)) continue;
+
+            if(node.leaf()) {
+                for(std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                    const T pmin[3] = {prim_min[i].x, prim_min[i].y, prim_min[i].z};
+                    const T pmax[3] = {prim_max[i].x, prim_max[i].y, prim_max[i].z};
+                    if(overlaps(pmin, pmax, lo, hi)) visit(indices[i]);
+                }
+                continue;
+            }
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+        }
+    }
+
+    /**
+    * @brief Closest hits of many rays against the primitive boxes.
+    * @param out one result per ray
+    */
+    void intersect(const bvh_ray<T>* rays, const std::size_t &count, bvh_hit<T>* out, const bool &parallel = true) const {
+        parallel_for_chunks(plan_chunks(count, query_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; i++) out[i] = intersect(rays[i]);
+        });
+    }
+
+    /**
+    * @brief Closest hits of many rays with an exact primitive test (must be thread-safe).
+    */
+    template <typename Hit, typename = std::enable_if_t<!std::is_arithmetic_v<std::decay_t<Hit>>>>
+    void intersect(const bvh_ray<T>* rays, const std::size_t &count, bvh_hit<T>* out, Hit&& hit, const bool &parallel = true) const {
+        parallel_for_chunks(plan_chunks(count, query_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; i++) out[i] = intersect(rays[i], hit);
+        });
+    }
+
+    /**
+    * @brief Nearest primitive boxes of many points.
+    */
+    void nearest(const vector3<T>* points, const std::size_t &count, bvh_nearest<T>* out,
+        const T &max_distance2 = std::numeric_limits<T>::infinity(), const bool &parallel = true) const
+    {
+        parallel_for_chunks(plan_chunks(count, query_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; i++) out[i] = nearest(points[i], max_distance2);
+        });
+    }
+
+    /**
+    * @brief Box queries of many boxes, calls visit(query, primitive). visit must be thread-safe.
+    */
+    template <typename Visit>
+    void query(const vector3<T>* box_min, const vector3<T>* box_max, const std::size_t &count, Visit&& visit, const bool &parallel = true) const {
+        parallel_for_chunks(plan_chunks(count, query_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; i++) {
+                query(box_min[i], box_max[i], [&visit, i](const std::uint32_t &primitive) { visit(i, primitive); });
+            }
+        });
+    }
+
+private:
+    /* Queries per parallel chunk */
+    static constexpr std::size_t query_grain = 1024;
+    /* Ranges above this size are binned in parallel and split into parallel subtrees */
+    static constexpr std::size_t parallel_threshold = 1 << 16;
+
+    /* Ordered traversal. leaf(slot, org, inv, t_max, t) returns whether the primitive is hit and stores the distance in t. */
+    template <typename Leaf>
+    bvh_hit<T> traverse_ray(const bvh_ray<T> &ray, Leaf&& leaf) const {
+        bvh_hit<T> result;
+        if(nodes.empty()) return result;
+
+        const T inv[3] = {T(1) / ray.direction.x, T(1) / ray.direction.y, T(1) / ray.direction.z};
+        const T org[3] = {ray.origin.x, ray.origin.y, ray.origin.z};
+        T t_max = ray.t_max;
+
+        std::uint32_t stack[max_stack];
+        std::size_t top = 0;
+        T t_root;
+        if(!slab(nodes[0], org, inv, ray.t_min, t_max, t_root)) return result;
+        stack[top++] = 0;
+
+        while(top) {
+            const bvh_node<T> &node = nodes[stack[--top]];
+            if(node.leaf()) {
+                for(std::size_t i = node.first; i < node.first + node.count; i++) {
+                    T t;
+                    if(!leaf(i, org, inv, t_max, t) || !std::isfinite(t)) continue;
+                    if(t >= ray.t_min && t <= t_max && (t < result.t || result.primitive == bvh_invalid)) {
+                        t_max = t;
+                        result.primitive = indices[i];
+                        result.t = t;
+                    }
+                }
+                continue;
+            }
+
+            /* push the far child first so the near one is popped next */
+            T tl, tr;
+            bool near_hit = slab(nodes[node.first], org, inv, ray.t_min, t_max, tl);
+            bool far_hit = slab(nodes[node.first + 1], org, inv, ray.t_min, t_max, tr);
+            std::uint32_t near_child = node.first, far_child = node.first + 1;
+            if(!near_hit || (far_hit && tr < tl)) {
+                std::swap(near_child, far_child);
+                std::swap(near_hit, far_hit);
+            }
+            if(far_hit) stack[top++] = far_child;
+            if(near_hit) stack[top++] = near_child;
+        }
+        return result;
+    }
+
+    /* Closest-first traversal with pruning. leaf(slot, point) returns the squared distance. */
+    template <typename Leaf>
+    bvh_nearest<T> traverse_nearest(const vector3<T> &point, const T &max_distance2, Leaf&& leaf) const {
+        bvh_nearest<T> result;
+        result.distance2 = max_distance2;
+        if(nodes.empty()) return result;
+
+        const T p[3] = {point.x, point.y, point.z};
+        std::uint32_t stack[max_stack];
+        std::size_t top = 0;
+        stack[top++] = 0;
+
+        while(top) {
+            const bvh_node<T> &node = nodes[stack[--top]];
+            if(box_distance2(node.min, node.max, p) > result.distance2) continue;
+
+            if(node.leaf()) {
+                for(std::size_t i = node.first; i < node.first + node.count; i++) {
+                    const T d = leaf(i, p);
+                    if(d < result.distance2 || (d == result.distance2 && result.primitive == bvh_invalid)) {
+                        result.distance2 = d;
+                        result.primitive = indices[i];
+                    }
+                }
+                continue;
+            }
+
+            const T dl = box_distance2(nodes[node.first].min, nodes[node.first].max, p);
+            const T dr = box_distance2(nodes[node.first + 1].min, nodes[node.first + 1].max, p);
+            const bool left_first = dl <= dr;
+            if(std::max(dl, dr) <= result.distance2) stack[top++] = left_first ? node.first + 1 : node.first;
+            if(std::min(dl, dr) <= result.distance2) stack[top++] = left_first ? node.first : node.first + 1;
+        }
+        return result;
+    }
+
+    /* Whether the ray enters the box within [t_min, t_max], the entry distance goes to t. */
+    static inline bool slab(const T bmin[3], const T bmax[3], const T org[3], const T inv[3], const T &t_min, const T &t_max, T &t) {
+        T t0 = t_min, t1 = t_max;
+        for(std::size_t a = 0; a < 3; a++) {
+            T n = (bmin[a] - org[a]) * inv[a];
+            T f = (bmax[a] - org[a]) * inv[a];
+            if(n > f) std::swap(n, f);
+            t0 = n > t0 ? n : t0;
+            t1 = f < t1 ? f : t1;
+        }
+        t = t0;
+        return t0 <= t1 && t0 < std::numeric_limits<T>::infinity();
+    }
+
+    static inline bool slab(const bvh_node<T> &node, const T org[3], const T inv[3], const T &t_min, const T &t_max, T &t) {
+        return slab(node.min, node.max, org, inv, t_min, t_max, t);
+    }
+
+    static inline T box_distance2(const T bmin[3], const T bmax[3], const T p[3]) {
+        T d2 = T(0);
+        for(std::size_t a = 0; a < 3; a++) {
+            const T d = std::max(std::max(bmin[a] - p[a], p[a] - bmax[a]), T(0));
+            d2 += d*d;
+        }
+        return d2;
+    }
+
+    static inline bool overlaps(const T amin[3], const T amax[3], const T bmin[3], const T bmax[3]) {
+        return amin[0] <= bmax[0] && amax[0] >= bmin[0] &&
+               amin[1] <= bmax[1] && amax[1] >= bmin[1] &&
+               amin[2] <= bmax[2] && amax[2] >= bmin[2];
+    }
+
+    void set_bounds(bvh_node<T> &node, const std::size_t &begin, const std::size_t &end) const {
+        for(std::size_t a = 0; a < 3; a++) {
+            node.min[a] = std::numeric_limits<T>::max();
+            node.max[a] = std::numeric_limits<T>::lowest();
+        }
+        for(std::size_t i = begin; i < end; i++) {
+            for(std::size_t a = 0; a < 3; a++) {
+                node.min[a] = std::min(node.min[a], prim_min[i].data[a]);
+                node.max[a] = std::max(node.max[a], prim_max[i].data[a]);
+            }
+        }
+    }
+
+    /* Primitive copy partitioned by the builder, keeps every pass over a range sequential in memory. */
+    struct prim_ref {
+        T min[3], max[3], c[3];
+        std::uint32_t index;
+    };
+
+    /* Box bounds, centroid bounds and primitive count of a set of primitives. */
+    struct bin {
+        T min[3], max[3];
+        T cmin[3], cmax[3];
+        std::size_t count;
+
+        inline void reset() {
+            for(std::size_t a = 0; a < 3; a++) {
+                min[a] = cmin[a] = std::numeric_limits<T>::max();
+                max[a] = cmax[a] = std::numeric_limits<T>::lowest();
+            }
+            count = 0;
+        }
+
+        inline void grow(const bin &other) {
+            for(std::size_t a = 0; a < 3; a++) {
+                min[a] = std::min(min[a], other.min[a]);
+                max[a] = std::max(max[a], other.max[a]);
+                cmin[a] = std::min(cmin[a], other.cmin[a]);
+                cmax[a] = std::max(cmax[a], other.cmax[a]);
+            }
+            count += other.count;
+        }
+
+        inline void grow(const prim_ref &ref) {
+            for(std::size_t a = 0; a < 3; a++) {
+                min[a] = std::min(min[a], ref.min[a]);
+                max[a] = std::max(max[a], ref.max[a]);
+                cmin[a] = std::min(cmin[a], ref.c[a]);
+                cmax[a] = std::max(cmax[a], ref.c[a]);
+            }
+            count++;
+        }
+
+        inline T area() const {
+            if(count == 0) return T(0);
+            const T dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+            return dx*dy + dy*dz + dz*dx;
+        }
+    };
+
+    /* SAH bins of a range along every axis */
+    struct bin_grid {
+        bin bins[3][bvh::bins];
+        T scale[3];
+
+        void setup(const bin &bounds) {
+            for(std::size_t a = 0; a < 3; a++) {
+                const T extent = bounds.cmax[a] - bounds.cmin[a];
+                scale[a] = extent > T(0) ? T(bvh::bins) / extent : T(0);
+                for(bin &b : bins[a]) b.reset();
+            }
+        }
+
+        inline std::size_t index(const bin &bounds, const std::size_t &axis, const T &c) const {
+            const std::size_t b = static_cast<std::size_t>((c - bounds.cmin[axis]) * scale[axis]);
+            return std::min(b, bvh::bins - 1);
+        }
+    };
+
+    struct builder {
+        bvh &tree;
+        std::vector<prim_ref> refs;
+        std::atomic<std::uint32_t> node_count{0};
+        std::size_t parallel_depth = 0;
+
+        builder(bvh &tree, const vector3<T>* min_bounds, const vector3<T>* max_bounds, const bool &parallel) :
+            tree(tree), refs(tree.indices.size())
+        {
+            if(parallel) {
+                for(std::size_t t = hardware_threads(); t > 1; t >>= 1) parallel_depth++;
+            }
+            parallel_for_chunks(plan_chunks(refs.size(), parallel_threshold, parallel ? 0 : 1),
+                [&](std::size_t, std::size_t begin, std::size_t end) {
+                    for(std::size_t i = begin; i < end; i++) {
+                        prim_ref &ref = refs[i];
+                        for(std::size_t a = 0; a < 3; a++) {
+                            ref.min[a] = min_bounds[i].data[a];
+                            ref.max[a] = max_bounds[i].data[a];
+                            ref.c[a] = (ref.min[a] + ref.max[a]) * T(0.5);
+                        }
+                        ref.index = static_cast<std::uint32_t>(i);
+                    }
+                });
+        }
+
+        bin bounds(const std::size_t &begin, const std::size_t &end, const bool &parallel) const {
+            const chunk_plan plan = plan_chunks(end - begin, parallel_threshold / 4, parallel ? 0 : 1);
+            std::vector<bin> partial(plan.chunks);
+            parallel_for_chunks(plan, [&](std::size_t c, std::size_t b, std::size_t e) {
+                partial[c].reset();
+                for(std::size_t i = begin + b; i < begin + e; i++) partial[c].grow(refs[i]);
+            });
+
+            bin result;
+            result.reset();
+            for(const bin &b : partial) result.grow(b);
+            return result;
+        }
+
+        /* One pass over the range, split between threads for large ranges */
+        void fill_bins(const std::size_t &begin, const std::size_t &end, const bin &bounds, bin_grid &grid, const bool &parallel) const {
+            grid.setup(bounds);
+            if(!parallel) {
+                for(std::size_t i = begin; i < end; i++) {
+                    for(std::size_t a = 0; a < 3; a++) grid.bins[a][grid.index(bounds, a, refs[i].c[a])].grow(refs[i]);
+                }
+                return;
+            }
+
+            const chunk_plan plan = plan_chunks(end - begin, parallel_threshold / 4);
+            std::vector<bin_grid> partial(plan.chunks, grid);
+            parallel_for_chunks(plan, [&](std::size_t c, std::size_t b, std::size_t e) {
+                bin_grid &g = partial[c];
+                for(std::size_t i = begin + b; i < begin + e; i++) {
+                    for(std::size_t a = 0; a < 3; a++) g.bins[a][g.index(bounds, a, refs[i].c[a])].grow(refs[i]);
+                }
+            });
+
+            for(std::size_t a = 0; a < 3; a++) {
+                for(std::size_t k = 0; k < bvh::bins; k++) {
+                    for(const bin_grid &g : partial) grid.bins[a][k].grow(g.bins[a][k]);
+                }
+            }
+        }
+
+        void make_leaf(bvh_node<T> &node, const bin &bounds, const std::size_t &begin, const std::size_t &end) {
+            for(std::size_t a = 0; a < 3; a++) {
+                node.min[a] = bounds.min[a];
+                node.max[a] = bounds.max[a];
+            }
+            node.first = static_cast<std::uint32_t>(begin);
+            node.count = static_cast<std::uint32_t>(end - begin);
+        }
+
+        /* bounds of the range come from the bins of the parent */
+        void build(const std::uint32_t &index, const std::size_t &begin, const std::size_t &end, const bin &bounds, const std::size_t &depth) {
+            const bool parallel = depth < parallel_depth && end - begin >= parallel_threshold;
+            const std::size_t count = end - begin;
+            bvh_node<T> &node = tree.nodes[index];
+
+            if(count <= tree.max_leaf_size || depth + 2 >= max_stack) {
+                make_leaf(node, bounds, begin, end);
+                return;
+            }
+
+            bin_grid grid;
+            fill_bins(begin, end, bounds, grid, parallel);
+
+            /* sweep the bins of every axis for the cheapest split plane */
+            const T node_area = bounds.area();
+            std::size_t best_axis = 3, best_split = 0;
+            bin best_left, best_right;
+            T best_cost = node_area * static_cast<T>(count); /* cost of a leaf */
+            for(std::size_t a = 0; a < 3; a++) {
+                if(grid.scale[a] == T(0)) continue;
+
+                bin right[bvh::bins];
+                bin acc;
+                acc.reset();
+                for(std::size_t k = bvh::bins; k-- > 1;) {
+                    acc.grow(grid.bins[a][k]);
+                    right[k] = acc;
+                }
+                acc.reset();
+                for(std::size_t k = 1; k < bvh::bins; k++) {
+                    acc.grow(grid.bins[a][k-1]);
+                    const T cost = tree.traversal_cost * node_area +
+                        acc.area() * static_cast<T>(acc.count) + right[k].area() * static_cast<T>(right[k].count);
+                    if(acc.count && right[k].count && cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = a;
+                        best_split = k;
+                        best_left = acc;
+                        best_right = right[k];
+                    }
+                }
+            }
+
+            std::size_t mid;
+            if(best_axis == 3) {
+                /* a leaf is cheaper or all centroids are equal, but the range is too big for a leaf */
+                mid = begin + count / 2;
+                best_left = this->bounds(begin, mid, parallel);
+                best_right = this->bounds(mid, end, parallel);
+            } else {
+                prim_ref* split = std::partition(refs.data() + begin, refs.data() + end,
+                    [&](const prim_ref &ref) { return grid.index(bounds, best_axis, ref.c[best_axis]) < best_split; });
+                mid = static_cast<std::size_t>(split - refs.data());
+            }
+
+            for(std::size_t a = 0; a < 3; a++) {
+                node.min[a] = bounds.min[a];
+                node.max[a] = bounds.max[a];
+            }
+            const std::uint32_t left = node_count.fetch_add(2);
+            node.first = left;
+            node.count = 0;
+
+            if(parallel) {
+                std::thread worker([&]() { build(left, begin, mid, best_left, depth + 1); });
+                build(left + 1, mid, end, best_right, depth + 1);
+                worker.join();
+            } else {
+                build(left, begin, mid, best_left, depth + 1);
+                build(left + 1, mid, end, best_right, depth + 1);
+            }
+        }
+    };
+};
+
+using bvhf = bvh<float>;
+using bvhd = bvh<double>;
+
+}
+
+#endif
@@ -1,7 +1,16 @@
 #ifndef CONSTFUNC_HPP
 #define CONSTFUNC_HPP
 
+#include <cstddef>
 #include <limits>
+#include <type_traits>
+
+/* true while a constexpr function is evaluated at compile time */
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+    #define MTP_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+    #define MTP_IS_CONSTANT_EVALUATED() false
+#endif
 
 namespace mtp {
 
@@ -23,6 +32,12 @@ constexpr inline size_t pow10(size_t p) {
     return (p == 0) ? 1 : 10 * pow10(p - 1);
 }
 
+template<typename T>
+T constexpr inline abs(const T &x)
+{
+    return x < T(0) ? -x : x;
+}
+
 template<typename T = float>
 T constexpr inline sqrtNewtonRaphson(const T &x, const T &curr, const T &prev)
 {
@@ -32,7 +47,7 @@ T constexpr inline sqrtNewtonRaphson(const T &x, const T &curr, const T &prev)
 }
 
 template<typename T = float>
-T constexpr inline sqrt(const T &x)
+std::enable_if_t<std::is_arithmetic_v<T>, T> constexpr inline sqrt(const T &x)
 {
     return x >= 0 && x < std::numeric_limits<T>::infinity()
         ? sqrtNewtonRaphson<T>(x, x, 0)
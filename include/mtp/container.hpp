@@ -1,29 +1,137 @@
 #ifndef MATH_TYPES_HPP
 #define MATH_TYPES_HPP
 
+#include <atomic>
 #include <type_traits>
 #include <cstring>
 #include <algorithm>
+#include <utility>
 
 #include "constfunc.hpp"
+#include "profile.hpp"
 
 /* Namespace Math Type*/
 
 namespace mtp {
 
-template <typename T, std::size_t Size, std::size_t Precition = 6>
-struct DataContainer {
-    static_assert(Size!=0, "DataContainer Size can't be zero.");
+/*
+* Storage policies of DataContainer.
+* storage_legacy  - data[Size] in a union with x, y, z, w / r, g, b, a, so every container is at least 4 elements wide.
+* storage_packed  - exactly Size elements, named members only up to Size (vector2f is 8 bytes, vector3f 12).
+* storage_aligned - padded to the next power of two bytes (at most 32, the AVX width) and aligned to it,
+*                   vector3f is 16 bytes on a 16 byte boundary, so whole containers can be loaded with one
+*                   aligned SIMD load. Padding elements are zero-initialized and never touched by the operators.
+*/
+struct storage_legacy {};
+struct storage_packed {};
+struct storage_aligned {};
+
+namespace detail {
+
+constexpr std::size_t storage_pow2(const std::size_t &bytes) {
+    std::size_t p = 1;
+    while(p < bytes) p <<= 1;
+    return p;
+}
+
+template <typename T, std::size_t Size, typename Storage>
+struct storage_traits {
+    static constexpr std::size_t named = 4;
+    static constexpr std::size_t capacity = Size;
+    static constexpr std::size_t alignment = alignof(T);
+};
+
+template <typename T, std::size_t Size>
+struct storage_traits<T, Size, storage_packed> {
+    static constexpr std::size_t named = Size < 4 ? Size : 4;
+    static constexpr std::size_t capacity = Size;
+    static constexpr std::size_t alignment = alignof(T);
+};
+
+template <typename T, std::size_t Size>
+struct storage_traits<T, Size, storage_aligned> {
+    static constexpr std::size_t named = Size < 4 ? Size : 4;
+    static constexpr std::size_t alignment = std::max(alignof(T), std::min<std::size_t>(32, storage_pow2(Size*sizeof(T))));
+    static constexpr std::size_t capacity = (Size*sizeof(T) + alignment - 1) / alignment * alignment / sizeof(T);
+};
+
+/* Element array of Capacity elements with the first Named elements also reachable by name. */
+template <typename T, std::size_t Capacity, std::size_t Named, std::size_t Align>
+struct alignas(Align) container_storage;
+
+template <typename T, std::size_t Capacity, std::size_t Align>
+struct alignas(Align) container_storage<T, Capacity, 1, Align> {
+    union {
+        T data[Capacity];
+        struct { T x; };
+        struct { T r; };
+    };
+
+    constexpr container_storage() : data{} {}
+
+    template <typename... Args>
+    constexpr container_storage(std::in_place_t, const Args&... args) : data{static_cast<T>(args)...} {}
+};
+
+template <typename T, std::size_t Capacity, std::size_t Align>
+struct alignas(Align) container_storage<T, Capacity, 2, Align> {
+    union {
+        T data[Capacity];
+        struct { T x, y; };
+        struct { T r, g; };
+    };
+
+    constexpr container_storage() : data{} {}
+
+    template <typename... Args>
+    constexpr container_storage(std::in_place_t, const Args&... args) : data{static_cast<T>(args)...} {}
+};
+
+template <typename T, std::size_t Capacity, std::size_t Align>
+struct alignas(Align) container_storage<T, Capacity, 3, Align> {
+    union {
+        T data[Capacity];
+        struct { T x, y, z; };
+        struct { T r, g, b; };
+    };
+
+    constexpr container_storage() : data{} {}
+
+    template <typename... Args>
+    constexpr container_storage(std::in_place_t, const Args&... args) : data{static_cast<T>(args)...} {}
+};
+
+template <typename T, std::size_t Capacity, std::size_t Align>
+struct alignas(Align) container_storage<T, Capacity, 4, Align> {
     union {
-        T data[Size];
+        T data[Capacity];
         struct { T x, y, z, w; };
         struct { T r, g, b, a; };
     };
 
+    constexpr container_storage() : data{} {}
+
+    template <typename... Args>
+    constexpr container_storage(std::in_place_t, const Args&... args) : data{static_cast<T>(args)...} {}
+};
+
+template <typename T, std::size_t Size, typename Storage>
+using container_storage_t = container_storage<T,
+    storage_traits<T, Size, Storage>::capacity, storage_traits<T, Size, Storage>::named, storage_traits<T, Size, Storage>::alignment>;
+
+}
+
+template <typename T, std::size_t Size, std::size_t Precition = 6, typename Storage = storage_legacy>
+struct DataContainer : detail::container_storage_t<T, Size, Storage> {
+    static_assert(Size!=0, "DataContainer Size can't be zero.");
+    using Base = detail::container_storage_t<T, Size, Storage>;
+    using Base::data;
+
     static constexpr float EPSILON = 1.0f / static_cast<float>(pow10(Precition));
     static constexpr std::size_t size = Size;
+    static constexpr std::size_t capacity = detail::storage_traits<T, Size, Storage>::capacity; /* Size plus padding */
     
-    constexpr DataContainer() : data{} 
+    constexpr DataContainer() : Base()
     {
 
     }
@@ -34,7 +142,7 @@ struct DataContainer {
     }
 
     template <typename... Args, typename = std::enable_if_t<sizeof...(Args) == Size>>
-    constexpr DataContainer(const Args&... args) : data{static_cast<T>(args)...} 
+    constexpr DataContainer(const Args&... args) : Base(std::in_place, args...) 
     {
 
     }
@@ -59,80 +167,104 @@ struct DataContainer {
     constexpr inline const T& operator[](const std::size_t &index) const {return data[index];}
 
     constexpr inline DataContainer operator+(const DataContainer& other) const {
+        MTP_PROFILE_OP(container, Size, Size);
         DataContainer result;
         for (size_t i = 0; i < Size; i++) result.data[i] = data[i] + other.data[i];
         return result;
     }
 
     constexpr inline DataContainer operator-(const DataContainer& other) const {
+        MTP_PROFILE_OP(container, Size, Size);
         DataContainer result;
         for (size_t i = 0; i < Size; i++) result.data[i] = data[i] - other.data[i];
         return result;
     }
     
     constexpr inline DataContainer operator*(const DataContainer& other) const {
+        MTP_PROFILE_OP(container, Size, Size);
         DataContainer result;
         for (size_t i = 0; i < Size; i++) result.data[i] = data[i] * other.data[i];
         return result;
     }
 
     constexpr inline DataContainer operator/(const DataContainer& other) const {
+        MTP_PROFILE_OP(container, Size, Size);
         DataContainer result;
         for (size_t i = 0; i < Size; i++) result.data[i] = data[i] / other.data[i];
         return result;
     }
 
     constexpr inline DataContainer operator+(const T &scalar) const {
+        MTP_PROFILE_OP(container, Size, Size);
         DataContainer result;
         for (size_t i = 0; i < Size; i++) result.data[i] = data[i] + scalar;
         return result;
     }
 
     constexpr inline DataContainer operator-(const T &scalar) const {
+        MTP_PROFILE_OP(container, Size, Size);
         DataContainer result;
         for (size_t i = 0; i < Size; i++) result.data[i] = data[i] - scalar;
         return result;
     }
 
     constexpr inline DataContainer operator*(const T &scalar) const {
+        MTP_PROFILE_OP(container, Size, Size);
         DataContainer result;
         for (size_t i = 0; i < Size; i++) result.data[i] = data[i] * scalar;
         return result;
     }
 
     constexpr inline DataContainer operator/(const T &scalar) const {
+        MTP_PROFILE_OP(container, Size, Size);
         DataContainer result;
         for (size_t i = 0; i < Size; i++) result.data[i] = data[i] / scalar;
         return result;
     }
 
     constexpr inline void operator+=(const DataContainer& other) {
+        MTP_PROFILE_OP(container, Size, Size);
         for (size_t i = 0; i < Size; i++) data[i] += other.data[i];
     }
 
     constexpr inline void operator-=(const DataContainer& other) {
+        MTP_PROFILE_OP(container, Size, Size);
         for (size_t i = 0; i < Size; i++) data[i] -= other.data[i];
     }
 
     constexpr inline void operator*=(const DataContainer& other) {
+        MTP_PROFILE_OP(container, Size, Size);
         for (size_t i = 0; i < Size; i++) data[i] *= other.data[i];
     }
 
     constexpr inline void operator/=(const DataContainer& other) {
+        MTP_PROFILE_OP(container, Size, Size);
         for (size_t i = 0; i < Size; i++) data[i] /= other.data[i];
     }
 
-    constexpr inline void operator+=(const T &scalar) {for (size_t i = 0; i < Size; i++) data[i] += scalar;}
+    constexpr inline void operator+=(const T &scalar) {
+        MTP_PROFILE_OP(container, Size, Size);
+        for (size_t i = 0; i < Size; i++) data[i] += scalar;
+    }
 
-    constexpr inline void operator-=(const T &scalar) {for (size_t i = 0; i < Size; i++) data[i] -= scalar;}
+    constexpr inline void operator-=(const T &scalar) {
+        MTP_PROFILE_OP(container, Size, Size);
+        for (size_t i = 0; i < Size; i++) data[i] -= scalar;
+    }
 
-    constexpr inline void operator*=(const T &scalar) {for (size_t i = 0; i < Size; i++) data[i] *= scalar;}
+    constexpr inline void operator*=(const T &scalar) {
+        MTP_PROFILE_OP(container, Size, Size);
+        for (size_t i = 0; i < Size; i++) data[i] *= scalar;
+    }
 
-    constexpr inline void operator/=(const T &scalar) {for (size_t i = 0; i < Size; i++) data[i] /= scalar;}
+    constexpr inline void operator/=(const T &scalar) {
+        MTP_PROFILE_OP(container, Size, Size);
+        for (size_t i = 0; i < Size; i++) data[i] /= scalar;
+    }
 
     /* Comparison operators. Returns only bitmask */
 
-    constexpr int operator>=(const DataContainer<T, Size>& other) {
+    constexpr int operator>=(const DataContainer& other) {
         int bitmask = 0;
         for (size_t i = 0; i < Size; i++) {
             if(data[i] >= other.data[i]) bitmask|=1;
@@ -141,7 +273,7 @@ struct DataContainer {
         return bitmask;
     }
 
-    constexpr int operator<=(const DataContainer<T, Size>& other) {
+    constexpr int operator<=(const DataContainer& other) {
         int bitmask = 0;
         for (size_t i = 0; i < Size; i++) {
             if(data[i] <= other.data[i]) bitmask|=1;
@@ -150,7 +282,7 @@ struct DataContainer {
         return bitmask;
     }
 
-    constexpr int operator>(const DataContainer<T, Size>& other) {
+    constexpr int operator>(const DataContainer& other) {
         int bitmask = 0;
         for (size_t i = 0; i < Size; i++) {
             if(data[i] > other.data[i]) bitmask|=1;
@@ -159,7 +291,7 @@ struct DataContainer {
         return bitmask;
     }
 
-    constexpr int operator<(const DataContainer<T, Size>& other) {
+    constexpr int operator<(const DataContainer& other) {
         int bitmask = 0;
         for (size_t i = 0; i < Size; i++) {
             if(data[i] < other.data[i]) bitmask|=1;
@@ -168,7 +300,7 @@ struct DataContainer {
         return bitmask;
     }
 
-    constexpr int operator==(const DataContainer<T, Size>& other) {
+    constexpr int operator==(const DataContainer& other) {
         if constexpr(std::is_floating_point_v<T>) {
             int bitmask = 0;
             for (size_t i = 0; i < Size; i++) {
@@ -185,7 +317,7 @@ struct DataContainer {
             return bitmask;
         }
     }
-    constexpr inline int operator!=(const DataContainer<T, Size>& other) {
+    constexpr inline int operator!=(const DataContainer& other) {
         if constexpr(std::is_floating_point_v<T>) {
             int bitmask = 0;
             for (size_t i = 0; i < Size; i++) {
@@ -204,96 +336,346 @@ struct DataContainer {
     }
 };
 
+/*
+* Inline storage of DynamicDataContainer in bytes, containers up to this size never touch the heap.
+* 256 bytes hold an 8x8 float matrix. The buffer is part of every container, including ones whose
+* data lives on the heap, so sizeof(dynamic_matrix<float>) is about 300 bytes whatever its size.
+* Define a smaller value (0 sends everything to the heap) where many containers are kept alive, or pick the
+* capacity per type through the Inline argument; the stencil, sampler, sparse, text and quantized
+* entry points accept any Inline.
+*/
+#ifndef MTP_SMALL_BUFFER_BYTES
+#define MTP_SMALL_BUFFER_BYTES 256
+#endif
+
+namespace detail {
+
 template <typename T>
+constexpr std::size_t small_buffer_capacity = MTP_SMALL_BUFFER_BYTES / sizeof(T);
+
+/* Owners of a shared heap buffer. */
+struct shared_count {
+    std::atomic<std::size_t> refs;
+};
+
+}
+
+/**
+* @brief Runtime sized array with a small buffer: up to Inline elements live inside the object,
+* larger sizes fall back to the heap. data always points at the active buffer.
+*
+* Copy-on-write is opt-in: share() turns a heap buffer into a reference counted one and returns
+* an O(1) snapshot, copies of a shared container are snapshots too. The first mutable access
+* (non-const operator[], begin/end, compound operators, resize) of a container whose buffer has
+* other owners copies it first. Writes through data bypass this, call detach() before them.
+* The count is atomic, so snapshots can be handed to other threads; one container object itself
+* is still not safe to use from several threads while one of them writes.
+* @arg Inline - Elements stored inline, 0 - always heap.
+*/
+template <typename T, std::size_t Inline = detail::small_buffer_capacity<T>>
 struct DynamicDataContainer {
     T* data;
     std::size_t size;
     
-    DynamicDataContainer() : data(nullptr), size(0) 
+    DynamicDataContainer() : data(local), size(0) 
     {
 
     }
 
-    DynamicDataContainer(const std::size_t& size) : data(new T[size]()), size(size) 
+    DynamicDataContainer(const std::size_t& size) : data(local), size(0) 
     {
-
+        allocate(size);
+        for(std::size_t i = 0; i < size; i++) data[i] = T();
     }
 
-    
-    DynamicDataContainer(const std::size_t& size, T* array) : data(array), size(size)
+    /* Takes ownership of array, which must come from new T[size]. */
+    DynamicDataContainer(const std::size_t& size, T* array) : data(array), size(size), allocated(size)
     {
-        
+        if(size == 0) {
+            /* an empty array holds nothing, free it and stay inline so capacity() never exceeds it */
+            delete[] array;
+            data = local;
+        }
     }
     
-    DynamicDataContainer(const std::size_t& size, const T& scalar) : data(new T[size]), size(size) 
+    DynamicDataContainer(const std::size_t& size, const T& scalar) : data(local), size(0) 
     {
+        allocate(size);
         for(std::size_t i = 0; i < size; i++) data[i] = scalar;
     }
+
+    /* Deep copy, O(1) snapshot if other is shared. */
+    DynamicDataContainer(const DynamicDataContainer& other) : data(local), size(0)
+    {
+        if(other.shared) {
+            attach(other);
+            return;
+        }
+        allocate(other.size);
+        std::copy(other.data, other.data + other.size, data);
+    }
+
+    /* Steals heap buffers, copies at most Inline elements otherwise. */
+    DynamicDataContainer(DynamicDataContainer&& other) noexcept : data(local), size(0)
+    {
+        take(other);
+    }
+
+    DynamicDataContainer& operator=(const DynamicDataContainer& other) {
+        if(this == &other) return *this;
+        if(other.shared) {
+            if(shared == other.shared) return *this;
+            release();
+            attach(other);
+            return *this;
+        }
+        if(shared || capacity() < other.size) {
+            release();
+            allocate(other.size);
+        }
+        size = other.size;
+        std::copy(other.data, other.data + other.size, data);
+        return *this;
+    }
+
+    DynamicDataContainer& operator=(DynamicDataContainer&& other) noexcept {
+        if(this == &other) return *this;
+        release();
+        take(other);
+        return *this;
+    }
     
     ~DynamicDataContainer() {
-        if(data) {
-            delete[] data;
-            data = nullptr;
+        release();
+    }
+
+    /* Elements that fit without reallocating. */
+    inline std::size_t capacity() const { return allocated ? allocated : Inline; }
+
+    /* True while the elements live in the inline buffer. */
+    inline bool is_inline() const { return data == local; }
+
+    /**
+    * @brief Snapshot sharing this buffer, this container switches to copy-on-write.
+    * Inline buffers are small and simply copied.
+    */
+    DynamicDataContainer share() {
+        enable_sharing();
+        return DynamicDataContainer(*this);
+    }
+
+    /* Containers owning the buffer, 1 unless shared. */
+    inline std::size_t use_count() const { return shared ? shared->refs.load(std::memory_order_acquire) : 1; }
+
+    /* True if writing now would copy the buffer. */
+    inline bool is_shared() const { return use_count() > 1; }
+
+    /* Makes the buffer unique, copying it if other containers still own it. */
+    inline void detach() {
+        if(shared) unshare();
+    }
+
+    /**
+    * @brief Changes the size keeping the first min(size, new_size) elements, new elements are zero.
+    * Reallocates only when new_size exceeds capacity().
+    */
+    void resize(const std::size_t &new_size) {
+        detach();
+        if(new_size > capacity()) {
+            DynamicDataContainer grown(new_size);
+            std::move(data, data + size, grown.data);
+            *this = std::move(grown);
+            return;
+        }
+        for(std::size_t i = size; i < new_size; i++) data[i] = T();
+        size = new_size;
+    }
+
+    void swap(DynamicDataContainer& other) noexcept {
+        if(!is_inline() && !other.is_inline()) {
+            std::swap(data, other.data);
+            std::swap(size, other.size);
+            std::swap(allocated, other.allocated);
+            std::swap(shared, other.shared);
+            return;
         }
+        DynamicDataContainer tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
     }
 
     using data_iterator  = T*;
     using data_citerator = const T*;
 
-    constexpr data_iterator begin() noexcept { return data; }
-    constexpr data_iterator end() noexcept { return data + size; }
+    inline data_iterator begin() { detach(); return data; }
+    inline data_iterator end() { detach(); return data + size; }
 
     constexpr data_citerator cbegin() const noexcept { return data; }
     constexpr data_citerator cend() const noexcept { return data + size; }
 
-    constexpr inline T& operator[](const std::size_t &index) {return data[index];}
+    inline T& operator[](const std::size_t &index) {detach(); return data[index];}
 
     constexpr inline const T& operator[](const std::size_t &index) const {return data[index];}
 
-    inline void operator+=(const T &scalar) {for (size_t i = 0; i < size; i++) data[i] += scalar;}
+    inline void operator+=(const T &scalar) {
+        MTP_PROFILE_OP(container, size, size);
+        detach();
+        for (size_t i = 0; i < size; i++) data[i] += scalar;
+    }
 
-    inline void operator-=(const T &scalar) {for (size_t i = 0; i < size; i++) data[i] -= scalar;}
+    inline void operator-=(const T &scalar) {
+        MTP_PROFILE_OP(container, size, size);
+        detach();
+        for (size_t i = 0; i < size; i++) data[i] -= scalar;
+    }
 
-    inline void operator*=(const T &scalar) {for (size_t i = 0; i < size; i++) data[i] *= scalar;}
+    inline void operator*=(const T &scalar) {
+        MTP_PROFILE_OP(container, size, size);
+        detach();
+        for (size_t i = 0; i < size; i++) data[i] *= scalar;
+    }
 
-    inline void operator/=(const T &scalar) {for (size_t i = 0; i < size; i++) data[i] /= scalar;}
+    inline void operator/=(const T &scalar) {
+        MTP_PROFILE_OP(container, size, size);
+        detach();
+        for (size_t i = 0; i < size; i++) data[i] /= scalar;
+    }
 
     inline DynamicDataContainer operator+(const T &scalar) const {
-        DynamicDataContainer result(size);
+        MTP_PROFILE_OP(container, size, size);
+        DynamicDataContainer result(size, uninitialized_tag());
         for (size_t i = 0; i < size; i++) result.data[i] = data[i] + scalar;
         return result;
     }
 
     inline DynamicDataContainer operator-(const T &scalar) const {
-        DynamicDataContainer result(size);
+        MTP_PROFILE_OP(container, size, size);
+        DynamicDataContainer result(size, uninitialized_tag());
         for (size_t i = 0; i < size; i++) result.data[i] = data[i] - scalar;
         return result;
     }
 
     inline DynamicDataContainer operator*(const T &scalar) const {
-        DynamicDataContainer result(size);
+        MTP_PROFILE_OP(container, size, size);
+        DynamicDataContainer result(size, uninitialized_tag());
         for (size_t i = 0; i < size; i++) result.data[i] = data[i] * scalar;
         return result;
     }
 
     inline DynamicDataContainer operator/(const T &scalar) const {
-        DynamicDataContainer result(size);
+        MTP_PROFILE_OP(container, size, size);
+        DynamicDataContainer result(size, uninitialized_tag());
         for (size_t i = 0; i < size; i++) result.data[i] = data[i] / scalar;
         return result;
     }
+
+protected:
+    struct uninitialized_tag {};
+
+    /* Puts a heap buffer under a reference count, copies made afterwards share it. */
+    void enable_sharing() {
+        if(allocated && !shared) shared = new detail::shared_count{{1}};
+    }
+
+    /* Storage for size elements whose values are about to be overwritten. */
+    DynamicDataContainer(const std::size_t& size, uninitialized_tag) : data(local), size(0)
+    {
+        allocate(size);
+    }
+
+    /* Sets the size to count and drops the old values, every element is zero afterwards. */
+    void reset(const std::size_t &count) {
+        if(shared || count > capacity()) {
+            release();
+            allocate(count);
+        }
+        size = count;
+        for(std::size_t i = 0; i < count; i++) data[i] = T();
+    }
+
+private:
+    alignas(alignof(T) > 16 ? alignof(T) : 16) T local[Inline ? Inline : 1];
+    std::size_t allocated = 0; /* heap capacity, 0 while inline */
+    detail::shared_count* shared = nullptr; /* set once share() was called on the heap buffer */
+
+    /* Points data at a buffer of at least count elements, expects an inline, empty container. */
+    void allocate(const std::size_t &count) {
+        if(count > Inline) {
+            MTP_PROFILE_OP(allocation, count, 0);
+            data = new T[count];
+            allocated = count;
+        }
+        size = count;
+    }
+
+    void release() {
+        if(shared) {
+            if(shared->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete[] data;
+                delete shared;
+            }
+        } else if(allocated) {
+            delete[] data;
+        }
+        data = local;
+        size = 0;
+        allocated = 0;
+        shared = nullptr;
+    }
+
+    /* Joins the owners of other's shared buffer, expects an inline, empty container. */
+    void attach(const DynamicDataContainer& other) {
+        other.shared->refs.fetch_add(1, std::memory_order_relaxed);
+        data = other.data;
+        size = other.size;
+        allocated = other.allocated;
+        shared = other.shared;
+    }
+
+    void unshare() {
+        if(shared->refs.load(std::memory_order_acquire) == 1) {
+            delete shared;
+            shared = nullptr;
+            return;
+        }
+        MTP_PROFILE_OP(allocation, size, 0);
+        T* copy = new T[allocated];
+        std::copy(data, data + size, copy);
+        if(shared->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete[] data;
+            delete shared;
+        }
+        data = copy;
+        shared = nullptr;
+    }
+
+    void take(DynamicDataContainer& other) {
+        if(other.allocated) {
+            data = other.data;
+            allocated = other.allocated;
+            shared = other.shared;
+        } else {
+            std::move(other.data, other.data + other.size, local);
+        }
+        size = other.size;
+        other.data = other.local;
+        other.size = 0;
+        other.allocated = 0;
+        other.shared = nullptr;
+    }
 };
 
-template <std::size_t NewSize, typename T, std::size_t OldSize>
-static constexpr inline DataContainer<T, NewSize> resize(const DataContainer<T, OldSize> &container) {
-    DataContainer<T, NewSize> new_container;
+template <std::size_t NewSize, typename T, std::size_t OldSize, std::size_t Precition, typename Storage>
+static constexpr inline DataContainer<T, NewSize, Precition, Storage> resize(const DataContainer<T, OldSize, Precition, Storage> &container) {
+    DataContainer<T, NewSize, Precition, Storage> new_container;
     
     for(std::size_t i = 0; i < std::min(OldSize, NewSize); i++) new_container.data[i] = container.data[i];
     return new_container;
 }
 
-template <typename T, typename CastType, std::size_t Size>
-static constexpr inline DataContainer<CastType, Size> cast(const DataContainer<T, Size> &container) {
-    DataContainer<CastType, Size> new_container;
+template <typename T, typename CastType, std::size_t Size, std::size_t Precition, typename Storage>
+static constexpr inline DataContainer<CastType, Size, Precition, Storage> cast(const DataContainer<T, Size, Precition, Storage> &container) {
+    DataContainer<CastType, Size, Precition, Storage> new_container;
     for(std::size_t i = 0; i < Size; i++) new_container.data[i] = static_cast<CastType>(container.data[i]);
     return new_container;
 }
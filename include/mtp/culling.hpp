@@ -0,0 +1,247 @@
+#ifndef CULLING_HPP
+#define CULLING_HPP
+
+#include <cstdint>
+#include <cmath>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace mtp {
+
+/* Plane order inside of frustum::planes */
+enum frustum_plane : std::size_t { plane_left, plane_right, plane_bottom, plane_top, plane_near, plane_far };
+
+/**
+* @brief Six normalized planes (nx, ny, nz, d). A point p is inside when dot(n, p) + d >= 0 for every plane.
+*/
+template <typename T>
+struct frustum {
+    vector4<T> planes[6];
+};
+
+/**
+* @brief Extracts frustum planes from a view-projection matrix (Gribb-Hartmann).
+* @param view_proj matrix in the layout of perspective()/orthographic(): column-major, translation in data[12..14].
+* @return Planes in world space (or in the space the matrix maps from).
+*/
+template <typename T>
+frustum<T> extract_frustum(const matrix<T, 4, 4> &view_proj) {
+    const T* m = view_proj.data;
+    frustum<T> result;
+
+    for(std::size_t i = 0; i < 3; i++) {
+        for(std::size_t c = 0; c < 4; c++) {
+            const T row_w = m[c*4+3];
+            const T row_i = m[c*4+i];
+            result.planes[i*2].data[c]   = row_w + row_i;
+            result.planes[i*2+1].data[c] = row_w - row_i;
+        }
+    }
+
+    for(vector4<T> &plane : result.planes) {
+        const T length = std::sqrt(plane.x*plane.x + plane.y*plane.y + plane.z*plane.z);
+        if(length > T(0)) plane /= length;
+    }
+    return result;
+}
+
+/* Axis-aligned boxes stored as structure of arrays. */
+template <typename T>
+struct aabb_soa {
+    const T *min_x, *min_y, *min_z;
+    const T *max_x, *max_y, *max_z;
+    std::size_t count;
+};
+
+/* Bounding spheres stored as structure of arrays. */
+template <typename T>
+struct sphere_soa {
+    const T *x, *y, *z;
+    const T *radius;
+    std::size_t count;
+};
+
+namespace detail {
+
+/*
+* Box test against the "positive vertex": for every plane the corner furthest along the normal
+* is picked by the sign of the normal, so the selection happens once per plane, not per box.
+*/
+template <typename T>
+struct aabb_tester {
+    const T* px[6]; const T* py[6]; const T* pz[6];
+    T nx[6], ny[6], nz[6], d[6];
+
+    aabb_tester(const frustum<T> &fr, const aabb_soa<T> &boxes) {
+        for(std::size_t p = 0; p < 6; p++) {
+            const vector4<T> &plane = fr.planes[p];
+            nx[p] = plane.x; ny[p] = plane.y; nz[p] = plane.z; d[p] = plane.w;
+            px[p] = plane.x >= T(0) ? boxes.max_x : boxes.min_x;
+            py[p] = plane.y >= T(0) ? boxes.max_y : boxes.min_y;
+            pz[p] = plane.z >= T(0) ? boxes.max_z : boxes.min_z;
+        }
+    }
+
+    inline bool test(const std::size_t &i) const {
+        for(std::size_t p = 0; p < 6; p++) {
+            if(nx[p]*px[p][i] + ny[p]*py[p][i] + nz[p]*pz[p][i] + d[p] < T(0)) return false;
+        }
+        return true;
+    }
+
+#if defined(MTP_AVX2)
+    /* 8 boxes starting at i, bit k set when box i+k is visible */
+    inline std::uint32_t test8(const std::size_t &i) const {
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(std::size_t p = 0; p < 6; p++) {
+            __m256 dist = _mm256_set1_ps(d[p]);
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(nx[p]), _mm256_loadu_ps(px[p] + i)));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(ny[p]), _mm256_loadu_ps(py[p] + i)));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(nz[p]), _mm256_loadu_ps(pz[p] + i)));
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        return static_cast<std::uint32_t>(_mm256_movemask_ps(visible));
+    }
+#endif
+};
+
+template <typename T>
+struct sphere_tester {
+    const T *x, *y, *z, *r;
+    T nx[6], ny[6], nz[6], d[6];
+
+    sphere_tester(const frustum<T> &fr, const sphere_soa<T> &spheres) :
+        x(spheres.x), y(spheres.y), z(spheres.z), r(spheres.radius)
+    {
+        for(std::size_t p = 0; p < 6; p++) {
+            nx[p] = fr.planes[p].x; ny[p] = fr.planes[p].y; nz[p] = fr.planes[p].z; d[p] = fr.planes[p].w;
+        }
+    }
+
+    inline bool test(const std::size_t &i) const {
+        for(std::size_t p = 0; p < 6; p++) {
+            if(nx[p]*x[i] + ny[p]*y[i] + nz[p]*z[i] + d[p] < -r[i]) return false;
+        }
+        return true;
+    }
+
+#if defined(MTP_AVX2)
+    inline std::uint32_t test8(const std::size_t &i) const {
+        const __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        const __m256 nr = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(r + i));
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(std::size_t p = 0; p < 6; p++) {
+            __m256 dist = _mm256_set1_ps(d[p]);
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(nx[p]), vx));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(ny[p]), vy));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(nz[p]), vz));
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, nr, _CMP_GE_OQ));
+        }
+        return static_cast<std::uint32_t>(_mm256_movemask_ps(visible));
+    }
+#endif
+};
+
+/* Calls emit(base, bits) for every 8 objects (fewer at the tail) of [begin, end). */
+template <typename T, typename Tester, typename Emit>
+inline void cull_range(const Tester &tester, const std::size_t &begin, const std::size_t &end, Emit&& emit) {
+    std::size_t i = begin;
+#if defined(MTP_AVX2)
+    if constexpr(std::is_same_v<T, float>) {
+        for(; i + 8 <= end; i += 8) emit(i, tester.test8(i));
+    }
+#endif
+    for(; i < end; i += 8) {
+        std::uint32_t bits = 0;
+        const std::size_t n = std::min<std::size_t>(8, end - i);
+        for(std::size_t k = 0; k < n; k++) bits |= static_cast<std::uint32_t>(tester.test(i+k)) << k;
+        emit(i, bits);
+    }
+}
+
+/* Objects per parallel chunk. A multiple of 64 so every chunk owns whole mask words. */
+constexpr std::size_t cull_grain = 64 * 256;
+
+template <typename T, typename Tester>
+void cull_mask(const Tester &tester, const std::size_t &count, std::uint64_t* mask, const bool &parallel) {
+    auto kernel = [&](std::size_t, std::size_t begin, std::size_t end) {
+        for(std::size_t w = begin / 64; w < (end + 63) / 64; w++) mask[w] = 0;
+        cull_range<T>(tester, begin, end, [mask](const std::size_t &base, const std::uint32_t &bits) {
+            mask[base / 64] |= static_cast<std::uint64_t>(bits) << (base % 64);
+        });
+    };
+    parallel_for_chunks(plan_chunks(count, cull_grain, parallel ? 0 : 1), kernel);
+}
+
+template <typename T, typename Tester>
+std::size_t cull_indices(const Tester &tester, const std::size_t &count, std::uint32_t* indices, const bool &parallel) {
+    const chunk_plan plan = plan_chunks(count, cull_grain, parallel ? 0 : 1);
+    std::vector<std::size_t> visible(plan.chunks, 0);
+
+    /* every chunk compacts into its own slice [begin, end) of the output ... */
+    parallel_for_chunks(plan, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        std::uint32_t* out = indices + begin;
+        cull_range<T>(tester, begin, end, [&out](const std::size_t &base, const std::uint32_t &bits) {
+            for(std::uint32_t k = 0; k < 8; k++) {
+                if((bits >> k) & 1) *out++ = static_cast<std::uint32_t>(base + k);
+            }
+        });
+        visible[chunk] = static_cast<std::size_t>(out - (indices + begin));
+    });
+
+    /* ... and the slices are moved down to a contiguous list */
+    std::size_t total = visible.empty() ? 0 : visible[0];
+    for(std::size_t c = 1; c < plan.chunks; c++) {
+        const std::uint32_t* src = indices + c * plan.chunk_size;
+        std::copy(src, src + visible[c], indices + total);
+        total += visible[c];
+    }
+    return total;
+}
+
+}
+
+/**
+* @brief Frustum test of boxes, writes the indices of visible boxes in ascending order.
+* @param indices output, room for boxes.count entries
+* @param parallel splits the work between hardware threads
+* @return Number of visible boxes.
+*/
+template <typename T>
+std::size_t cull_aabbs(const frustum<T> &fr, const aabb_soa<T> &boxes, std::uint32_t* indices, const bool &parallel = false) {
+    return detail::cull_indices<T>(detail::aabb_tester<T>(fr, boxes), boxes.count, indices, parallel);
+}
+
+/**
+* @brief Frustum test of boxes, bit i of the mask is set when box i is visible.
+* @param mask output, (boxes.count + 63) / 64 words
+*/
+template <typename T>
+void cull_aabbs_mask(const frustum<T> &fr, const aabb_soa<T> &boxes, std::uint64_t* mask, const bool &parallel = false) {
+    detail::cull_mask<T>(detail::aabb_tester<T>(fr, boxes), boxes.count, mask, parallel);
+}
+
+/**
+* @brief Frustum test of spheres, writes the indices of visible spheres in ascending order.
+* @param indices output, room for spheres.count entries
+* @return Number of visible spheres.
+*/
+template <typename T>
+std::size_t cull_spheres(const frustum<T> &fr, const sphere_soa<T> &spheres, std::uint32_t* indices, const bool &parallel = false) {
+    return detail::cull_indices<T>(detail::sphere_tester<T>(fr, spheres), spheres.count, indices, parallel);
+}
+
+/**
+* @brief Frustum test of spheres, bit i of the mask is set when sphere i is visible.
+* @param mask output, (spheres.count + 63) / 64 words
+*/
+template <typename T>
+void cull_spheres_mask(const frustum<T> &fr, const sphere_soa<T> &spheres, std::uint64_t* mask, const bool &parallel = false) {
+    detail::cull_mask<T>(detail::sphere_tester<T>(fr, spheres), spheres.count, mask, parallel);
+}
+
+}
+
+#endif
@@ -44,6 +44,7 @@ struct quadratic_lerp : public lerp2p<N, 1> {
     */
     template<std::size_t n = N, typename std::enable_if_t<n==2, int> = 0>
     inline float interp(const float& x_new) {
+        MTP_PROFILE_OP(interpolation, 3, 27);
         return
             this->sp.y * (((x_new-this->ap.x) * (x_new-this->ep.x)) / ((this->sp.x-this->ap.x) * (this->sp.x-this->ep.x))) +
             this->ap.y * (((x_new-this->sp.x) * (x_new-this->ep.x)) / ((this->ap.x-this->sp.x) * (this->ap.x-this->ep.x))) + 
@@ -56,6 +57,7 @@ struct quadratic_lerp : public lerp2p<N, 1> {
     */
     template<std::size_t n = N, typename std::enable_if_t<n==3, int> = 0>
     inline vector2f interp(const float& x_new) {
+        MTP_PROFILE_OP(interpolation, 3, 31);
         const float res1 = ((x_new-this->ap.x) * (x_new-this->ep.x)) / ((this->sp.x-this->ap.x) * (this->sp.x-this->ep.x));
         const float res2 = ((x_new-this->sp.x) * (x_new-this->ep.x)) / ((this->ap.x-this->sp.x) * (this->ap.x-this->ep.x));
         const float res3 = ((x_new-this->sp.x) * (x_new-this->ap.x)) / ((this->ep.x-this->sp.x) * (this->ep.x-this->ap.x));
@@ -98,6 +100,7 @@ struct bezier_curve : public lerp2p<N, Exp-1> {
     */
     template <std::size_t E = Exp, typename std::enable_if_t<E == 2 && N==2, int> = 0>
     inline float interp(const float &t) {
+        MTP_PROFILE_OP(interpolation, 3, 10);
         const float dt = (1.0f - t);
         return dt*dt * this->sp.y + 2.0f * t * dt * this->control_points[0].y + t*t * this->ep.y;
     }
@@ -108,6 +111,7 @@ struct bezier_curve : public lerp2p<N, Exp-1> {
     */
     template <std::size_t E = Exp, typename std::enable_if_t<E == 2 && N==3, int> = 0>
     inline vector2f interp(const float &t) {
+        MTP_PROFILE_OP(interpolation, 3, 16);
         const float dt = (1.0f - t);
         const float dt2= dt*dt;
         const float t2 = t*t;
@@ -123,6 +127,7 @@ struct bezier_curve : public lerp2p<N, Exp-1> {
     */
     template <std::size_t B = Exp, typename std::enable_if_t<B == 3 && N == 2, int> = 0>
     inline float interp(const float &t) {
+        MTP_PROFILE_OP(interpolation, 4, 17);
         const float dt = (1.0f - t);
         const float dt2= dt*dt;
         const float t2 = t*t;
@@ -137,6 +142,7 @@ struct bezier_curve : public lerp2p<N, Exp-1> {
     */
     template <std::size_t B = Exp, typename std::enable_if_t<B == 3 && N == 3, int> = 0>
     inline vector2f interp(const float &t) {
+        MTP_PROFILE_OP(interpolation, 4, 26);
         const float dt = (1.0f - t);
         const float dt2= dt*dt;
         const float dt3= dt*dt;
@@ -172,6 +178,7 @@ struct bezier_curve : public lerp2p<N, Exp-1> {
 * @param factor value within range 0.0 - 1.0
 */
 static constexpr inline float linear_lerp(const float &start, const float &end, const float &factor) {
+    MTP_PROFILE_OP(interpolation, 2, 3);
     return start + (end-start)*factor;
 }
 
@@ -184,6 +191,7 @@ static constexpr inline float linear_lerp(const float &start, const float &end,
 */
 template <typename T, std::size_t N>
 static constexpr inline vector<T, N> linear_lerp(const vector<T, N> &start, const vector<T, N> &end, const float &factor) {
+    MTP_PROFILE_OP(interpolation, 2*N, 3*N);
     return start + (end-start)*factor;
 }
 
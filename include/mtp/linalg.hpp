@@ -0,0 +1,244 @@
+#ifndef LINALG_HPP
+#define LINALG_HPP
+
+#include <type_traits>
+
+#include "matrix.hpp"
+#include "constfunc.hpp"
+
+namespace mtp {
+
+/*
+* Determinant, inverse and linear solve of square fixed-size matrices.
+* A(row, col) = data[row*N + col], the layout of matrix::get(col, row) and matrix * vector.
+* Everything is constexpr: constant inputs are reduced at compile time with pivoted Gaussian
+* elimination, runtime calls with N <= 4 use closed forms. A matrix is singular when a pivot
+* (or the closed-form determinant) is exactly zero.
+*/
+
+namespace detail {
+
+/* Partial pivoting LU in place, a is N*N row-major. Returns the determinant, 0 for singular matrices. */
+template <typename T, std::size_t N>
+constexpr T gauss_reduce(T (&a)[N*N], std::size_t (&perm)[N]) {
+    T det = T(1);
+    for(std::size_t i = 0; i < N; i++) perm[i] = i;
+
+    for(std::size_t k = 0; k < N; k++) {
+        std::size_t pivot = k;
+        for(std::size_t r = k + 1; r < N; r++) {
+            if(abs(a[r*N+k]) > abs(a[pivot*N+k])) pivot = r;
+        }
+        if(a[pivot*N+k] == T(0)) return T(0);
+        if(pivot != k) {
+            for(std::size_t c = 0; c < N; c++) {
+                const T tmp = a[k*N+c];
+                a[k*N+c] = a[pivot*N+c];
+                a[pivot*N+c] = tmp;
+            }
+            const std::size_t tmp = perm[k];
+            perm[k] = perm[pivot];
+            perm[pivot] = tmp;
+            det = -det;
+        }
+
+        det *= a[k*N+k];
+        for(std::size_t r = k + 1; r < N; r++) {
+            const T factor = a[r*N+k] / a[k*N+k];
+            a[r*N+k] = factor;
+            for(std::size_t c = k + 1; c < N; c++) a[r*N+c] -= factor * a[k*N+c];
+        }
+    }
+    return det;
+}
+
+/* Solves L*U*x = P*b for a reduced matrix, b and x may alias. */
+template <typename T, std::size_t N>
+constexpr void gauss_substitute(const T (&lu)[N*N], const std::size_t (&perm)[N], const T* b, T* x) {
+    T y[N] = {};
+    for(std::size_t r = 0; r < N; r++) {
+        T sum = b[perm[r]];
+        for(std::size_t c = 0; c < r; c++) sum -= lu[r*N+c] * y[c];
+        y[r] = sum;
+    }
+    for(std::size_t r = N; r-- > 0;) {
+        T sum = y[r];
+        for(std::size_t c = r + 1; c < N; c++) sum -= lu[r*N+c] * y[c];
+        y[r] = sum / lu[r*N+r];
+    }
+    for(std::size_t i = 0; i < N; i++) x[i] = y[i];
+}
+
+/* Fraction-free (Bareiss) elimination, exact for integer matrices. */
+template <typename T, std::size_t N>
+constexpr T bareiss_determinant(T (&a)[N*N]) {
+    T sign = T(1), previous = T(1);
+    for(std::size_t k = 0; k + 1 < N; k++) {
+        if(a[k*N+k] == T(0)) {
+            std::size_t r = k + 1;
+            while(r < N && a[r*N+k] == T(0)) r++;
+            if(r == N) return T(0);
+            for(std::size_t c = 0; c < N; c++) {
+                const T tmp = a[k*N+c];
+                a[k*N+c] = a[r*N+c];
+                a[r*N+c] = tmp;
+            }
+            sign = -sign;
+        }
+        for(std::size_t r = k + 1; r < N; r++) {
+            for(std::size_t c = k + 1; c < N; c++) a[r*N+c] = (a[r*N+c] * a[k*N+k] - a[r*N+k] * a[k*N+c]) / previous;
+        }
+        previous = a[k*N+k];
+    }
+    return sign * a[N*N-1];
+}
+
+template <typename T, std::size_t N>
+constexpr T closed_determinant(const T* m) {
+    if constexpr(N == 1) {
+        return m[0];
+    } else if constexpr(N == 2) {
+        return m[0]*m[3] - m[1]*m[2];
+    } else if constexpr(N == 3) {
+        return m[0]*(m[4]*m[8] - m[5]*m[7]) - m[1]*(m[3]*m[8] - m[5]*m[6]) + m[2]*(m[3]*m[7] - m[4]*m[6]);
+    } else {
+        const T s0 = m[0]*m[5] - m[1]*m[4], s1 = m[0]*m[6] - m[2]*m[4], s2 = m[0]*m[7] - m[3]*m[4];
+        const T s3 = m[1]*m[6] - m[2]*m[5], s4 = m[1]*m[7] - m[3]*m[5], s5 = m[2]*m[7] - m[3]*m[6];
+        const T c5 = m[10]*m[15] - m[11]*m[14], c4 = m[9]*m[15] - m[11]*m[13], c3 = m[9]*m[14] - m[10]*m[13];
+        const T c2 = m[8]*m[15] - m[11]*m[12], c1 = m[8]*m[14] - m[10]*m[12], c0 = m[8]*m[13] - m[9]*m[12];
+        return s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+    }
+}
+
+/* Adjugate / determinant, false for a zero determinant. */
+template <typename T, std::size_t N>
+constexpr bool closed_inverse(const T* m, T* out) {
+    if constexpr(N == 1) {
+        if(m[0] == T(0)) return false;
+        out[0] = T(1) / m[0];
+        return true;
+    } else if constexpr(N == 2) {
+        const T det = closed_determinant<T, 2>(m);
+        if(det == T(0)) return false;
+        const T inv = T(1) / det;
+        const T a = m[0], b = m[1], c = m[2], d = m[3];
+        out[0] = d*inv;  out[1] = -b*inv;
+        out[2] = -c*inv; out[3] = a*inv;
+        return true;
+    } else if constexpr(N == 3) {
+        const T det = closed_determinant<T, 3>(m);
+        if(det == T(0)) return false;
+        const T inv = T(1) / det;
+        const T r[9] = {
+            (m[4]*m[8] - m[5]*m[7])*inv, (m[2]*m[7] - m[1]*m[8])*inv, (m[1]*m[5] - m[2]*m[4])*inv,
+            (m[5]*m[6] - m[3]*m[8])*inv, (m[0]*m[8] - m[2]*m[6])*inv, (m[2]*m[3] - m[0]*m[5])*inv,
+            (m[3]*m[7] - m[4]*m[6])*inv, (m[1]*m[6] - m[0]*m[7])*inv, (m[0]*m[4] - m[1]*m[3])*inv
+        };
+        for(std::size_t i = 0; i < 9; i++) out[i] = r[i];
+        return true;
+    } else {
+        const T s0 = m[0]*m[5] - m[1]*m[4], s1 = m[0]*m[6] - m[2]*m[4], s2 = m[0]*m[7] - m[3]*m[4];
+        const T s3 = m[1]*m[6] - m[2]*m[5], s4 = m[1]*m[7] - m[3]*m[5], s5 = m[2]*m[7] - m[3]*m[6];
+        const T c5 = m[10]*m[15] - m[11]*m[14], c4 = m[9]*m[15] - m[11]*m[13], c3 = m[9]*m[14] - m[10]*m[13];
+        const T c2 = m[8]*m[15] - m[11]*m[12], c1 = m[8]*m[14] - m[10]*m[12], c0 = m[8]*m[13] - m[9]*m[12];
+        const T det = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+        if(det == T(0)) return false;
+        const T inv = T(1) / det;
+        const T r[16] = {
+            ( m[5]*c5 - m[6]*c4 + m[7]*c3)*inv, (-m[1]*c5 + m[2]*c4 - m[3]*c3)*inv, ( m[13]*s5 - m[14]*s4 + m[15]*s3)*inv, (-m[9]*s5 + m[10]*s4 - m[11]*s3)*inv,
+            (-m[4]*c5 + m[6]*c2 - m[7]*c1)*inv, ( m[0]*c5 - m[2]*c2 + m[3]*c1)*inv, (-m[12]*s5 + m[14]*s2 - m[15]*s1)*inv, ( m[8]*s5 - m[10]*s2 + m[11]*s1)*inv,
+            ( m[4]*c4 - m[5]*c2 + m[7]*c0)*inv, (-m[0]*c4 + m[1]*c2 - m[3]*c0)*inv, ( m[12]*s4 - m[13]*s2 + m[15]*s0)*inv, (-m[8]*s4 + m[9]*s2 - m[11]*s0)*inv,
+            (-m[4]*c3 + m[5]*c1 - m[6]*c0)*inv, ( m[0]*c3 - m[1]*c1 + m[2]*c0)*inv, (-m[12]*s3 + m[13]*s1 - m[14]*s0)*inv, ( m[8]*s3 - m[9]*s1 + m[10]*s0)*inv
+        };
+        for(std::size_t i = 0; i < 16; i++) out[i] = r[i];
+        return true;
+    }
+}
+
+}
+
+/**
+* @brief Determinant of a square matrix. Integer matrices use fraction-free elimination and stay exact.
+*/
+template <typename T, std::size_t N, typename Storage>
+constexpr T determinant(const matrix<T, N, N, Storage> &m) {
+    if constexpr(N <= 4) {
+        if(!MTP_IS_CONSTANT_EVALUATED()) return detail::closed_determinant<T, N>(m.data);
+    }
+    T a[N*N] = {};
+    for(std::size_t i = 0; i < N*N; i++) a[i] = m.data[i];
+    if constexpr(std::is_integral_v<T>) {
+        return detail::bareiss_determinant<T, N>(a);
+    } else {
+        std::size_t perm[N] = {};
+        return detail::gauss_reduce<T, N>(a, perm);
+    }
+}
+
+/**
+* @brief Inverse of a square matrix.
+* @param out receives the inverse, untouched if the matrix is singular
+* @return false if the matrix is singular.
+*/
+template <typename T, std::size_t N, typename Storage>
+constexpr bool invert(const matrix<T, N, N, Storage> &m, matrix<T, N, N, Storage> &out) {
+    static_assert(std::is_floating_point_v<T>, "invert requires a floating point matrix.");
+    if constexpr(N <= 4) {
+        if(!MTP_IS_CONSTANT_EVALUATED()) return detail::closed_inverse<T, N>(m.data, out.data);
+    }
+    T a[N*N] = {};
+    std::size_t perm[N] = {};
+    for(std::size_t i = 0; i < N*N; i++) a[i] = m.data[i];
+    if(detail::gauss_reduce<T, N>(a, perm) == T(0)) return false;
+
+    /* one column of the identity at a time */
+    T column[N] = {};
+    for(std::size_t c = 0; c < N; c++) {
+        T e[N] = {};
+        e[c] = T(1);
+        detail::gauss_substitute<T, N>(a, perm, e, column);
+        for(std::size_t r = 0; r < N; r++) out.data[r*N+c] = column[r];
+    }
+    return true;
+}
+
+/**
+* @brief Inverse of a square matrix, a zero matrix if it is singular. See invert() to detect that case.
+*/
+template <typename T, std::size_t N, typename Storage>
+constexpr matrix<T, N, N, Storage> inverse(const matrix<T, N, N, Storage> &m) {
+    matrix<T, N, N, Storage> result;
+    if(!invert(m, result)) return matrix<T, N, N, Storage>();
+    return result;
+}
+
+/**
+* @brief Solves a * x = b.
+* @return false if a is singular, x is untouched then.
+*/
+template <typename T, std::size_t N, typename Storage, std::size_t P, typename VStorage>
+constexpr bool solve(const matrix<T, N, N, Storage> &a, const vector<T, N, P, VStorage> &b, vector<T, N, P, VStorage> &x) {
+    static_assert(std::is_floating_point_v<T>, "solve requires a floating point matrix.");
+    if constexpr(N <= 4) {
+        if(!MTP_IS_CONSTANT_EVALUATED()) {
+            T inv[N*N] = {};
+            if(!detail::closed_inverse<T, N>(a.data, inv)) return false;
+            T r[N] = {};
+            for(std::size_t i = 0; i < N; i++) {
+                for(std::size_t j = 0; j < N; j++) r[i] += inv[i*N+j] * b.data[j];
+            }
+            for(std::size_t i = 0; i < N; i++) x.data[i] = r[i];
+            return true;
+        }
+    }
+    T lu[N*N] = {};
+    std::size_t perm[N] = {};
+    for(std::size_t i = 0; i < N*N; i++) lu[i] = a.data[i];
+    if(detail::gauss_reduce<T, N>(lu, perm) == T(0)) return false;
+    detail::gauss_substitute<T, N>(lu, perm, b.data, x.data);
+    return true;
+}
+
+}
+
+#endif
@@ -6,9 +6,9 @@
 
 namespace mtp {
 
-template <typename T, std::size_t N, std::size_t M = N>
-struct matrix : public DataContainer<T, N*M> {
-    using DataContainer<T, N*M>::DataContainer;
+template <typename T, std::size_t N, std::size_t M = N, typename Storage = storage_legacy>
+struct matrix : public DataContainer<T, N*M, 6, Storage> {
+    using DataContainer<T, N*M, 6, Storage>::DataContainer;
 
     constexpr matrix(const matrix&) noexcept = default;
 
@@ -36,6 +36,7 @@ struct matrix : public DataContainer<T, N*M> {
 
     /* vector-matrix multiplication - O(N^2) */
     vector<T, N> operator*(const DataContainer<T, N>& vec) {
+        MTP_PROFILE_OP(matmul, N*M, 2*N*M);
         vector<T, N> new_vector;
         for (size_t i = 0; i < M; i++) {
             for (size_t j = 0; j < N; j++) new_vector.data[i]+=vec.data[j]*this->data[i * N + j];
@@ -71,8 +72,9 @@ struct matrix : public DataContainer<T, N*M> {
     } /* M!=N - O(M*N) | M==N - O(N^2) */
 
     /* classic matrix multiplication */
-    matrix<T, N, M> operator*(const DataContainer<T, N*M>& mat) {
-        matrix<T, N, M> new_mat;
+    matrix operator*(const DataContainer<T, N*M, 6, Storage>& mat) {
+        MTP_PROFILE_OP(matmul, N*M, 2*M*N*N);
+        matrix new_mat;
         for (size_t i = 0; i < M; i++) {
             size_t index = i*N;
             for (size_t j = 0; j < N; j++) {
@@ -85,8 +87,8 @@ struct matrix : public DataContainer<T, N*M> {
     } /* M!=N - O(M*N^2) | M==N - O(N^3) */
 
     /* classic matrix sum */
-    matrix<T, N, M> operator+(const DataContainer<T, N*M>& mat) {
-        matrix<T, N, M> new_mat;
+    matrix operator+(const DataContainer<T, N*M, 6, Storage>& mat) {
+        matrix new_mat;
         for (size_t i = 0; i < M; i++) {
             size_t index = i*N;
             for (size_t j = 0; j < N; j++) {
@@ -99,7 +101,7 @@ struct matrix : public DataContainer<T, N*M> {
     } /* M!=N - O(M*N^2) | M==N - O(N^3) */
 
     /* classic matrix subtraction */
-    matrix<T, N, M> operator-(const DataContainer<T, N*M>& mat) {
+    matrix operator-(const DataContainer<T, N*M, 6, Storage>& mat) {
         vector<T, N, M> new_mat;
         for (size_t i = 0; i < M; i++) {
             size_t index = i*N;
@@ -113,7 +115,7 @@ struct matrix : public DataContainer<T, N*M> {
     } /* M!=N - O(M*N^2) | M==N - O(N^3) */
 
     /* classic matrix division */
-    matrix<T, N, M> operator/(const DataContainer<T, N*M>& mat) {
+    matrix operator/(const DataContainer<T, N*M, 6, Storage>& mat) {
         vector<T, N, M> new_mat;
         for (size_t i = 0; i < M; i++) {
             size_t index = i*N;
@@ -127,21 +129,25 @@ struct matrix : public DataContainer<T, N*M> {
     } /* M!=N - O(M*N^2) | M==N - O(N^3) */
 };
 
-template <typename T>
-struct dynamic_matrix : DynamicDataContainer<T> {
+/**
+* @brief Runtime sized 2D matrix, matrices up to Inline elements are stored without heap allocations.
+* @arg Inline - Inline capacity in elements, see DynamicDataContainer.
+*/
+template <typename T, std::size_t Inline = detail::small_buffer_capacity<T>>
+struct dynamic_matrix : DynamicDataContainer<T, Inline> {
     std::size_t n = 0;
     std::size_t m = 0;
 
-    using DynamicDataContainer<T>::DynamicDataContainer;
+    using DynamicDataContainer<T, Inline>::DynamicDataContainer;
 
     dynamic_matrix(const std::size_t &rows, const std::size_t &cols) : n(rows), m(cols),
-        DynamicDataContainer<T>(rows*cols)
+        DynamicDataContainer<T, Inline>(rows*cols)
     {
 
     }
 
     dynamic_matrix(const std::size_t &rows, const std::size_t &cols, const T& scalar) : n(rows), m(cols),
-        DynamicDataContainer<T>(rows*cols, scalar)
+        DynamicDataContainer<T, Inline>(rows*cols, scalar)
     {
         
     }
@@ -153,23 +159,40 @@ struct dynamic_matrix : DynamicDataContainer<T> {
     * @return Returns T object.
     */
     inline T& get(const size_t& x, const size_t& y) {
+        this->detach();
         return this->data[y*n+x];
     }
 
-    /* resizes 2-dimensional matrix and resets all values in array to zero */
+    /* Read access, never copies a shared buffer. */
+    inline const T& get(const size_t& x, const size_t& y) const {
+        return this->data[y*n+x];
+    }
+
+    /* resizes 2-dimensional matrix and resets all values in array to zero, keeps the buffer if it is large enough */
     void resize(const std::size_t &rows, const std::size_t &cols) {
         n = rows;
         m = cols;
+        this->reset(rows*cols);
+    }
 
-        if(this->data != nullptr) delete[] this->data; 
-        this->data = new T[rows*cols]();
+    /* O(1) copy-on-write snapshot, see DynamicDataContainer::share. */
+    dynamic_matrix share() {
+        this->enable_sharing();
+        return dynamic_matrix(*this);
+    }
+
+    /* Exchanges contents and dimensions, O(1) unless a buffer is inline. */
+    void swap(dynamic_matrix &other) noexcept {
+        DynamicDataContainer<T, Inline>::swap(other);
+        std::swap(n, other.n);
+        std::swap(m, other.m);
     }
 };
 
 template <typename T, std::size_t W, std::size_t H = W, std::size_t V = H>
 struct matrix3d : public DataContainer<T, W*H*V> {
     static_assert(W!=0 || H!=0 || V!=0, "Matrix size can't be zero.");
-    static constexpr size_t WH = W*H; /* The size of the layer of 3d matrix. */
+    static constexpr size_t layer = W*V; /* Elements of one layer, layers follow each other along y. */
 
     using DataContainer<T, W*H*V>::DataContainer;
 
@@ -183,57 +206,78 @@ struct matrix3d : public DataContainer<T, W*H*V> {
     * @param y Height
     * @param z Volume
     */
-    constexpr inline const T& get(const size_t& x, const size_t& y, const size_t& z) {
-        static_assert(x<=W || y<=H || z<=V, "The cordinates exceed the limits of 3d matrix.");
+    constexpr inline const T& get(const size_t& x, const size_t& y, const size_t& z) const {
+        return this->data[index(x, y, z)];
+    }
 
-        return this->data[y*WH+z*W+x];
+    /* Offset of xyz in the array, same layout as dynamic_matrix3d::index. */
+    static constexpr inline std::size_t index(const size_t& x, const size_t& y, const size_t& z) {
+        return y*layer+z*W+x;
     }
 };
 
-template <typename T>
-struct dynamic_matrix3d : DynamicDataContainer<T> {
+template <typename T, std::size_t Inline = detail::small_buffer_capacity<T>>
+struct dynamic_matrix3d : DynamicDataContainer<T, Inline> {
     std::size_t w = 0;
     std::size_t h = 0;
     std::size_t v = 0;
 
-    using DynamicDataContainer<T>::DynamicDataContainer;
+    using DynamicDataContainer<T, Inline>::DynamicDataContainer;
 
     dynamic_matrix3d(const std::size_t &width, const std::size_t &height, const std::size_t &volume) : 
-        w(width), h(height), v(volume), DynamicDataContainer<T>(width*height*volume)
+        w(width), h(height), v(volume), DynamicDataContainer<T, Inline>(width*height*volume)
     {
 
     }
 
     dynamic_matrix3d(const std::size_t &width, const std::size_t &height, const std::size_t &volume, const T& scalar) : 
-        w(width), h(height), v(volume), DynamicDataContainer<T>(width*height*volume, scalar)
+        w(width), h(height), v(volume), DynamicDataContainer<T, Inline>(width*height*volume, scalar)
     {
         
     }
 
+    /* Offset of xyz in the array. Layers of w*v elements follow each other along y. */
+    constexpr inline std::size_t index(const size_t& x, const size_t& y, const size_t& z) const {
+        return y*w*v+z*w+x;
+    }
+
     /**
     * @brief Gets an object by xyz cordinates.
     * @param x Width
     * @param y Height
     * @param z Volume
     */
-    constexpr inline const T& get(const size_t& x, const size_t& y, const size_t& z) {
-        return this->data[y*w*h+z*w+x];
+    constexpr inline const T& get(const size_t& x, const size_t& y, const size_t& z) const {
+        return this->data[index(x, y, z)];
     }
 
-    /* resizes 3-dimensional matrix and resets all values in array to zero */
+    /* resizes 3-dimensional matrix and resets all values in array to zero, keeps the buffer if it is large enough */
     void resize(const std::size_t &width, const std::size_t &height, const std::size_t &volume) {
         this->w = width;
         this->h = height;
         this->v = volume;
+        this->reset(width*height*volume);
+    }
 
-        if(this->data != nullptr) delete[] this->data; 
-        this->data = new T[width*height*volume]();
+    /* O(1) copy-on-write snapshot, see DynamicDataContainer::share. */
+    dynamic_matrix3d share() {
+        this->enable_sharing();
+        return dynamic_matrix3d(*this);
+    }
+
+    /* Exchanges contents and dimensions, O(1) unless a buffer is inline. */
+    void swap(dynamic_matrix3d &other) noexcept {
+        DynamicDataContainer<T, Inline>::swap(other);
+        std::swap(w, other.w);
+        std::swap(h, other.h);
+        std::swap(v, other.v);
     }
 };
 
-template <typename T, std::size_t N, std::size_t M>
-constexpr matrix<T, M, N> transpose(const matrix<T, N, M>& mat) {
-    matrix<T, M, N> new_matrix;
+template <typename T, std::size_t N, std::size_t M, typename Storage>
+constexpr matrix<T, M, N, Storage> transpose(const matrix<T, N, M, Storage>& mat) {
+    MTP_PROFILE_OP(transpose, N*M, 0);
+    matrix<T, M, N, Storage> new_matrix;
     for(std::size_t i = 0; i < M; i++) {
         for(std::size_t j = 0; j < N; j++) {
             new_matrix.data[j*N+i] = mat.data[i*N+j];
@@ -242,9 +286,10 @@ constexpr matrix<T, M, N> transpose(const matrix<T, N, M>& mat) {
     return new_matrix;
 }
 
-template <typename T>
-dynamic_matrix<T> transpose(const dynamic_matrix<T>& mat) {
-    dynamic_matrix<T> new_matrix(mat.m, mat.n);
+template <typename T, std::size_t Inline>
+dynamic_matrix<T, Inline> transpose(const dynamic_matrix<T, Inline>& mat) {
+    MTP_PROFILE_OP(transpose, mat.size, 0);
+    dynamic_matrix<T, Inline> new_matrix(mat.m, mat.n);
     for(std::size_t i = 0; i < mat.m; i++) {
         for(std::size_t j = 0; j < mat.n; j++) {
             new_matrix.data[j*mat.n+i] = mat.data[i*mat.n+j];
@@ -266,6 +311,10 @@ template <typename T> using matrix4 = matrix<T, 4, 4>;
 template <typename T> using matrix3 = matrix<T, 3, 3>;
 template <typename T> using matrix2 = matrix<T, 2, 2>;
 
+template <typename T, std::size_t N, std::size_t M = N> using aligned_matrix = matrix<T, N, M, storage_aligned>;
+
+using matrix4f_aligned = aligned_matrix<float, 4>;
+
 }
 
 #endif
\ No newline at end of file
@@ -1,4 +1,17 @@
 #pragma once
 
 #include "transform.hpp"
-#include "lerp2p.hpp"
\ No newline at end of file
+#include "lerp2p.hpp"
+#include "quantized.hpp"
+#include "culling.hpp"
+#include "pipeline.hpp"
+#include "bvh.hpp"
+#include "sparse.hpp"
+#include "sampler.hpp"
+#include "stencil.hpp"
+#include "textio.hpp"
+#include "animation.hpp"
+#include "spline.hpp"
+#include "linalg.hpp"
+#include "vmath.hpp"
+#include "skinning.hpp"
\ No newline at end of file
@@ -0,0 +1,178 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <type_traits>
+#include <cstddef>
+#include <algorithm>
+
+namespace mtp {
+
+/* Number of worker threads used by the parallel kernels. */
+inline std::size_t hardware_threads() {
+    const unsigned threads = std::thread::hardware_concurrency();
+    return threads ? threads : 1;
+}
+
+/* Split of [0, count) into equal chunks. Chunk size is always a multiple of the grain. */
+struct chunk_plan {
+    std::size_t count = 0;
+    std::size_t chunks = 0;
+    std::size_t chunk_size = 0;
+};
+
+/**
+* @param count number of elements
+* @param grain minimum (and alignment of the) chunk size
+* @param max_chunks upper limit of chunks, 0 - one chunk per hardware thread
+*/
+inline chunk_plan plan_chunks(const std::size_t &count, std::size_t grain, std::size_t max_chunks = 0) {
+    chunk_plan plan;
+    plan.count = count;
+    if(count == 0) return plan;
+    if(grain == 0) grain = 1;
+    if(max_chunks == 0) max_chunks = hardware_threads();
+
+    const std::size_t grains = (count + grain - 1) / grain;
+    const std::size_t chunks = std::min(max_chunks, grains);
+    plan.chunk_size = ((grains + chunks - 1) / chunks) * grain;
+    plan.chunks = (count + plan.chunk_size - 1) / plan.chunk_size;
+    return plan;
+}
+
+namespace detail {
+
+/* One parallel_for_chunks call. Lives on the stack of the caller, chunks are claimed through next. */
+struct parallel_job {
+    const chunk_plan* plan;
+    void* fn;
+    void (*run)(void* fn, std::size_t chunk, std::size_t begin, std::size_t end);
+    std::atomic<std::size_t> next{0};
+    std::size_t users = 0; /* pool workers inside of the job, guarded by the pool mutex */
+
+    /* Runs one unclaimed chunk, false when none are left. */
+    bool claim() {
+        const std::size_t c = next.fetch_add(1);
+        if(c >= plan->chunks) return false;
+        const std::size_t begin = c * plan->chunk_size;
+        run(fn, c, begin, std::min(plan->count, begin + plan->chunk_size));
+        return true;
+    }
+};
+
+/*
+* hardware_threads() - 1 workers started on first use and kept until exit.
+* The submitting thread claims chunks of its own job as well, so nested calls from inside of a
+* chunk never wait for a chunk that nobody runs.
+*/
+class thread_pool {
+public:
+    static thread_pool &instance() {
+        static thread_pool pool(hardware_threads() - 1);
+        return pool;
+    }
+
+    void run(parallel_job &job) {
+        if(!workers.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(&job);
+            }
+            wake.notify_all();
+        }
+        while(job.claim()) {}
+
+        /* every chunk is claimed, wait for the ones that run on workers */
+        std::unique_lock<std::mutex> lock(mutex);
+        remove(job);
+        finished.wait(lock, [&job]() { return job.users == 0; });
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for(std::thread &worker : workers) worker.join();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    std::deque<parallel_job*> jobs;
+    std::vector<std::thread> workers;
+    bool stop = false;
+
+    explicit thread_pool(const std::size_t &threads) {
+        workers.reserve(threads);
+        for(std::size_t t = 0; t < threads; t++) workers.emplace_back([this]() { work(); });
+    }
+
+    void remove(parallel_job &job) {
+        const auto it = std::find(jobs.begin(), jobs.end(), &job);
+        if(it != jobs.end()) jobs.erase(it);
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for(;;) {
+            wake.wait(lock, [this]() { return stop || !jobs.empty(); });
+            if(stop) return;
+            parallel_job &job = *jobs.front();
+            job.users++;
+            lock.unlock();
+            while(job.claim()) {}
+            lock.lock();
+            remove(job);
+            if(--job.users == 0) finished.notify_all();
+        }
+    }
+};
+
+template <typename Fn>
+void invoke_chunk(void* fn, std::size_t chunk, std::size_t begin, std::size_t end) {
+    (*static_cast<Fn*>(fn))(chunk, begin, end);
+}
+
+}
+
+/**
+* @brief Runs fn(chunk, begin, end) for every chunk of the plan.
+* Chunks run on a shared pool of hardware_threads() - 1 workers (started once, reused by every call)
+* and on the calling thread, a single chunk runs inline. A call still costs a wake-up and a join of
+* the workers, so small batches are cheaper with parallel = false.
+*/
+template <typename Fn>
+void parallel_for_chunks(const chunk_plan &plan, Fn&& fn) {
+    if(plan.chunks == 0) return;
+    if(plan.chunks == 1) {
+        fn(std::size_t(0), std::size_t(0), plan.count);
+        return;
+    }
+
+    using fn_type = std::remove_reference_t<Fn>;
+    detail::parallel_job job;
+    job.plan = &plan;
+    job.fn = const_cast<void*>(static_cast<const void*>(&fn));
+    job.run = &detail::invoke_chunk<fn_type>;
+    detail::thread_pool::instance().run(job);
+}
+
+/**
+* @brief Runs fn(begin, end) over [0, count) split between hardware threads.
+* @param grain minimum chunk size, smaller ranges run on the calling thread
+*/
+template <typename Fn>
+void parallel_for(const std::size_t &count, const std::size_t &grain, Fn&& fn) {
+    parallel_for_chunks(plan_chunks(count, grain), [&fn](std::size_t, std::size_t begin, std::size_t end) { fn(begin, end); });
+}
+
+}
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <cstdint>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace mtp {
+
+/*
+* Object space -> screen space in one pass over the vertex buffer.
+* Matrices follow the layout of perspective()/orthographic()/setPos(): column-major,
+* translation in data[12..14], clip = M * (x, y, z, 1).
+*/
+
+/**
+* @brief Product a * b of two matrices in the column-major layout of transform.hpp.
+*/
+template <typename T>
+constexpr matrix<T, 4, 4> compose(const matrix<T, 4, 4> &a, const matrix<T, 4, 4> &b) {
+    matrix<T, 4, 4> result;
+    for(std::size_t c = 0; c < 4; c++) {
+        for(std::size_t r = 0; r < 4; r++) {
+            T sum = T(0);
+            for(std::size_t k = 0; k < 4; k++) sum += a.data[k*4+r] * b.data[c*4+k];
+            result.data[c*4+r] = sum;
+        }
+    }
+    return result;
+} /* O(N^3) */
+
+/**
+* @brief Precomputes projection * view * model.
+*/
+template <typename T>
+constexpr matrix<T, 4, 4> model_view_projection(const matrix<T, 4, 4> &model, const matrix<T, 4, 4> &view, const matrix<T, 4, 4> &projection) {
+    return compose(projection, compose(view, model));
+}
+
+/* Screen rectangle and depth range. Screen y grows with NDC y (bottom-left origin). */
+template <typename T>
+struct viewport {
+    T x = 0, y = 0;
+    T width = 1, height = 1;
+    T min_depth = 0, max_depth = 1;
+};
+
+/* Bits of the clip mask, set when the vertex lies outside of the plane. */
+enum clip_flag : std::uint8_t {
+    clip_left   = 1 << 0,
+    clip_right  = 1 << 1,
+    clip_bottom = 1 << 2,
+    clip_top    = 1 << 3,
+    clip_near   = 1 << 4,
+    clip_far    = 1 << 5
+};
+
+/* Object-space positions stored as structure of arrays. */
+template <typename T>
+struct vertex_soa {
+    const T *x, *y, *z;
+    std::size_t count;
+};
+
+/* Object-space positions inside of interleaved vertices. */
+template <typename T>
+struct vertex_interleaved {
+    const T* position; /* x of the first vertex, y and z follow */
+    std::size_t stride; /* distance between vertices in elements of T */
+    std::size_t count;
+};
+
+/* Output streams. w receives 1/w_clip for perspective-correct interpolation and may be nullptr. */
+template <typename T>
+struct screen_soa {
+    T *x, *y, *z;
+    T *w = nullptr;
+};
+
+namespace detail {
+
+template <typename T>
+struct projector {
+    T m[16];
+    T sx, ox, sy, oy, sz, oz; /* viewport mapping folded into scale + offset */
+
+    projector(const matrix<T, 4, 4> &mvp, const viewport<T> &vp) {
+        std::copy(mvp.data, mvp.data + 16, m);
+        sx = vp.width * T(0.5);  ox = vp.x + sx;
+        sy = vp.height * T(0.5); oy = vp.y + sy;
+        sz = (vp.max_depth - vp.min_depth) * T(0.5); oz = vp.min_depth + sz;
+    }
+
+    inline void project(const std::size_t &i, const T &x, const T &y, const T &z, const screen_soa<T> &out, std::uint8_t* clip) const {
+        const T cx = m[0]*x + m[4]*y + m[8]*z  + m[12];
+        const T cy = m[1]*x + m[5]*y + m[9]*z  + m[13];
+        const T cz = m[2]*x + m[6]*y + m[10]*z + m[14];
+        const T cw = m[3]*x + m[7]*y + m[11]*z + m[15];
+
+        if(clip) {
+            clip[i] = static_cast<std::uint8_t>(
+                (cx < -cw ? clip_left : 0)   | (cx > cw ? clip_right : 0) |
+                (cy < -cw ? clip_bottom : 0) | (cy > cw ? clip_top : 0)   |
+                (cz < -cw ? clip_near : 0)   | (cz > cw ? clip_far : 0));
+        }
+
+        const T inv = T(1) / cw;
+        out.x[i] = cx * inv * sx + ox;
+        out.y[i] = cy * inv * sy + oy;
+        out.z[i] = cz * inv * sz + oz;
+        if(out.w) out.w[i] = inv;
+    }
+
+#if defined(MTP_AVX2)
+    static inline __m256 fmadd(const __m256 &a, const __m256 &b, const __m256 &c) {
+#if defined(MTP_FMA)
+        return _mm256_fmadd_ps(a, b, c);
+#else
+        return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+    }
+
+    static inline __m256 row(const T* r, const __m256 &x, const __m256 &y, const __m256 &z) {
+        return fmadd(_mm256_set1_ps(r[0]), x, fmadd(_mm256_set1_ps(r[4]), y, fmadd(_mm256_set1_ps(r[8]), z, _mm256_set1_ps(r[12]))));
+    }
+
+    /* 8 vertices starting at i */
+    inline void project8(const std::size_t &i, const __m256 &x, const __m256 &y, const __m256 &z, const screen_soa<T> &out, std::uint8_t* clip) const {
+        const __m256 cx = row(m + 0, x, y, z);
+        const __m256 cy = row(m + 1, x, y, z);
+        const __m256 cz = row(m + 2, x, y, z);
+        const __m256 cw = row(m + 3, x, y, z);
+
+        if(clip) {
+            const __m256 ncw = _mm256_sub_ps(_mm256_setzero_ps(), cw);
+            const __m256i flags = _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cx, ncw, _CMP_LT_OQ)), _mm256_set1_epi32(clip_left)),
+                    _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cx, cw,  _CMP_GT_OQ)), _mm256_set1_epi32(clip_right))),
+                _mm256_or_si256(
+                    _mm256_or_si256(
+                        _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cy, ncw, _CMP_LT_OQ)), _mm256_set1_epi32(clip_bottom)),
+                        _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cy, cw,  _CMP_GT_OQ)), _mm256_set1_epi32(clip_top))),
+                    _mm256_or_si256(
+                        _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cz, ncw, _CMP_LT_OQ)), _mm256_set1_epi32(clip_near)),
+                        _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(cz, cw,  _CMP_GT_OQ)), _mm256_set1_epi32(clip_far)))));
+
+            /* 8 x int32 -> 8 x uint8 */
+            const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(flags), _mm256_extracti128_si256(flags, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(clip + i), _mm_packus_epi16(words, words));
+        }
+
+        const __m256 inv = _mm256_div_ps(_mm256_set1_ps(1.0f), cw);
+        _mm256_storeu_ps(out.x + i, fmadd(_mm256_mul_ps(cx, inv), _mm256_set1_ps(sx), _mm256_set1_ps(ox)));
+        _mm256_storeu_ps(out.y + i, fmadd(_mm256_mul_ps(cy, inv), _mm256_set1_ps(sy), _mm256_set1_ps(oy)));
+        _mm256_storeu_ps(out.z + i, fmadd(_mm256_mul_ps(cz, inv), _mm256_set1_ps(sz), _mm256_set1_ps(oz)));
+        if(out.w) _mm256_storeu_ps(out.w + i, inv);
+    }
+#endif
+};
+
+/* Vertices per parallel chunk */
+constexpr std::size_t pipeline_grain = 16384;
+
+}
+
+/**
+* @brief Fused clip transform, perspective divide and viewport mapping of SoA positions.
+* @param mvp precomputed model_view_projection()
+* @param clip optional output, one clip_flag mask per vertex
+* @param parallel splits the buffer between hardware threads
+*/
+template <typename T>
+void project_vertices(const matrix<T, 4, 4> &mvp, const viewport<T> &vp, const vertex_soa<T> &in,
+    const screen_soa<T> &out, std::uint8_t* clip = nullptr, const bool &parallel = false)
+{
+    const detail::projector<T> proj(mvp, vp);
+
+    auto kernel = [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::size_t i = begin;
+#if defined(MTP_AVX2)
+        if constexpr(std::is_same_v<T, float>) {
+            for(; i + 8 <= end; i += 8) {
+                proj.project8(i, _mm256_loadu_ps(in.x + i), _mm256_loadu_ps(in.y + i), _mm256_loadu_ps(in.z + i), out, clip);
+            }
+        }
+#endif
+        for(; i < end; i++) proj.project(i, in.x[i], in.y[i], in.z[i], out, clip);
+    };
+    parallel_for_chunks(plan_chunks(in.count, detail::pipeline_grain, parallel ? 0 : 1), kernel);
+}
+
+/**
+* @brief Fused clip transform, perspective divide and viewport mapping of interleaved vertices.
+* @param mvp precomputed model_view_projection()
+* @param clip optional output, one clip_flag mask per vertex
+* @param parallel splits the buffer between hardware threads
+*/
+template <typename T>
+void project_vertices(const matrix<T, 4, 4> &mvp, const viewport<T> &vp, const vertex_interleaved<T> &in,
+    const screen_soa<T> &out, std::uint8_t* clip = nullptr, const bool &parallel = false)
+{
+    const detail::projector<T> proj(mvp, vp);
+
+    auto kernel = [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::size_t i = begin;
+#if defined(MTP_AVX2)
+        if constexpr(std::is_same_v<T, float>) {
+            const int s = static_cast<int>(in.stride);
+            const __m256i offsets = _mm256_setr_epi32(0, s, 2*s, 3*s, 4*s, 5*s, 6*s, 7*s);
+            for(; i + 8 <= end; i += 8) {
+                const T* base = in.position + i*in.stride;
+                proj.project8(i, _mm256_i32gather_ps(base, offsets, 4), _mm256_i32gather_ps(base + 1, offsets, 4),
+                    _mm256_i32gather_ps(base + 2, offsets, 4), out, clip);
+            }
+        }
+#endif
+        for(; i < end; i++) {
+            const T* v = in.position + i*in.stride;
+            proj.project(i, v[0], v[1], v[2], out, clip);
+        }
+    };
+    parallel_for_chunks(plan_chunks(in.count, detail::pipeline_grain, parallel ? 0 : 1), kernel);
+}
+
+}
+
+#endif
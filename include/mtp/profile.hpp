@@ -0,0 +1,254 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+/*
+* Opt-in instrumentation. Define MTP_ENABLE_PROFILING before including any mtp header (or pass
+* -DMTP_ENABLE_PROFILING) to count calls, touched elements and FLOPs per operation category and
+* to record scoped timers. Without the define every hook expands to nothing.
+*
+* Counters live in a per-thread block, so recording never locks or issues atomic read-modify-write
+* instructions. Blocks are linked into a global list once per thread and are never freed, so the
+* summary also covers threads that already exited.
+*/
+
+#include <cstddef>
+
+#include "constfunc.hpp"
+
+#define MTP_PROFILE_CONCAT_IMPL(a, b) a##b
+#define MTP_PROFILE_CONCAT(a, b) MTP_PROFILE_CONCAT_IMPL(a, b)
+
+#if defined(MTP_ENABLE_PROFILING)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace mtp {
+namespace profile {
+
+enum class category : std::size_t {
+    container,     /* element-wise DataContainer / DynamicDataContainer arithmetic */
+    matmul,        /* matrix-matrix and matrix-vector products */
+    transpose,
+    normalize,
+    interpolation, /* lerp2p, bezier_curve, linear_lerp */
+    allocation,    /* heap allocations of dynamic containers */
+    math,          /* element-wise exp, log, sin, cos, tanh, pow, sqrt */
+    count
+};
+
+static constexpr const char* category_names[] = {
+    "container", "matmul", "transpose", "normalize", "interpolation", "allocation", "math"
+};
+
+struct totals {
+    std::uint64_t calls = 0;
+    std::uint64_t elements = 0;
+    std::uint64_t flops = 0;
+};
+
+struct timer_event {
+    const char* name;
+    std::int64_t start_ns;
+    std::int64_t duration_ns;
+};
+
+namespace detail {
+
+struct counter {
+    std::atomic<std::uint64_t> value{0};
+
+    /* Only the owning thread writes, readers may load concurrently. */
+    inline void add(const std::uint64_t &v) {
+        value.store(value.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+};
+
+struct thread_block {
+    counter calls[static_cast<std::size_t>(category::count)];
+    counter elements[static_cast<std::size_t>(category::count)];
+    counter flops[static_cast<std::size_t>(category::count)];
+    std::vector<timer_event> events;
+    std::size_t thread_index = 0;
+    thread_block* next = nullptr;
+};
+
+inline std::atomic<thread_block*> blocks{nullptr};
+inline std::atomic<std::size_t> thread_counter{0};
+
+inline thread_block& local_block() {
+    thread_local thread_block* block = []() {
+        thread_block* created = new thread_block();
+        created->thread_index = thread_counter.fetch_add(1, std::memory_order_relaxed);
+        created->next = blocks.load(std::memory_order_relaxed);
+        while(!blocks.compare_exchange_weak(created->next, created, std::memory_order_release, std::memory_order_relaxed));
+        return created;
+    }();
+    return *block;
+}
+
+/* Writes text as a JSON string literal. */
+inline void write_json_string(std::FILE* out, const char* text) {
+    std::fputc('"', out);
+    for(const char* c = text; *c; c++) {
+        const unsigned char ch = static_cast<unsigned char>(*c);
+        if(ch == '"' || ch == '\\') std::fprintf(out, "\\%c", ch);
+        else if(ch < 0x20) std::fprintf(out, "\\u%04x", ch);
+        else std::fputc(ch, out);
+    }
+    std::fputc('"', out);
+}
+
+inline std::int64_t now_ns() {
+    static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+}
+
+/**
+* @brief Records one call of an operation.
+* @param cat operation category
+* @param elements number of elements read or written
+* @param flops arithmetic operations performed
+*/
+inline void record(const category &cat, const std::uint64_t &elements, const std::uint64_t &flops) {
+    detail::thread_block &block = detail::local_block();
+    const std::size_t i = static_cast<std::size_t>(cat);
+    block.calls[i].add(1);
+    block.elements[i].add(elements);
+    block.flops[i].add(flops);
+}
+
+/* Sum of the counters of all threads. */
+inline totals snapshot(const category &cat) {
+    totals result;
+    const std::size_t i = static_cast<std::size_t>(cat);
+    for(detail::thread_block* b = detail::blocks.load(std::memory_order_acquire); b; b = b->next) {
+        result.calls    += b->calls[i].value.load(std::memory_order_relaxed);
+        result.elements += b->elements[i].value.load(std::memory_order_relaxed);
+        result.flops    += b->flops[i].value.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+/* Resets the counters and drops the timer events. Call it while no other thread records. */
+inline void reset() {
+    for(detail::thread_block* b = detail::blocks.load(std::memory_order_acquire); b; b = b->next) {
+        for(std::size_t i = 0; i < static_cast<std::size_t>(category::count); i++) {
+            b->calls[i].value.store(0, std::memory_order_relaxed);
+            b->elements[i].value.store(0, std::memory_order_relaxed);
+            b->flops[i].value.store(0, std::memory_order_relaxed);
+        }
+        b->events.clear();
+    }
+}
+
+/**
+* @brief Measures the lifetime of the object and stores it as a timer event of the current thread.
+* @param name must outlive the profiling session (string literals).
+*/
+struct scoped_timer {
+    const char* name;
+    std::int64_t start;
+
+    explicit scoped_timer(const char* name) : name(name), start(detail::now_ns())
+    {
+
+    }
+
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+
+    ~scoped_timer() {
+        detail::local_block().events.push_back({name, start, detail::now_ns() - start});
+    }
+};
+
+/**
+* @brief Prints per-category counters and per-timer totals.
+* Timer events are read without synchronization, so call it while no other thread records.
+*/
+inline void print_summary(std::FILE* out = stdout) {
+    std::fprintf(out, "%-14s %14s %16s %16s\n", "category", "calls", "elements", "flops");
+    for(std::size_t i = 0; i < static_cast<std::size_t>(category::count); i++) {
+        const totals t = snapshot(static_cast<category>(i));
+        std::fprintf(out, "%-14s %14llu %16llu %16llu\n", category_names[i],
+            static_cast<unsigned long long>(t.calls), static_cast<unsigned long long>(t.elements),
+            static_cast<unsigned long long>(t.flops));
+    }
+
+    struct timer_total { const char* name; std::uint64_t calls; std::int64_t ns; };
+    std::vector<timer_total> timers;
+    for(detail::thread_block* b = detail::blocks.load(std::memory_order_acquire); b; b = b->next) {
+        for(const timer_event &e : b->events) {
+            std::size_t i = 0;
+            while(i < timers.size() && timers[i].name != e.name) i++;
+            if(i == timers.size()) timers.push_back({e.name, 0, 0});
+            timers[i].calls++;
+            timers[i].ns += e.duration_ns;
+        }
+    }
+    if(timers.empty()) return;
+
+    std::fprintf(out, "\n%-30s %14s %16s\n", "timer", "calls", "total ms");
+    for(const timer_total &t : timers) {
+        std::fprintf(out, "%-30s %14llu %16.3f\n", t.name, static_cast<unsigned long long>(t.calls), t.ns / 1e6);
+    }
+}
+
+/**
+* @brief Writes the timer events as Chrome trace JSON (chrome://tracing, Perfetto).
+* Category counters are appended as metadata. Call it while no other thread records.
+* @return false if the file can't be opened.
+*/
+inline bool write_chrome_trace(const char* path) {
+    std::FILE* out = std::fopen(path, "w");
+    if(!out) return false;
+
+    std::fprintf(out, "{\"traceEvents\":[");
+    bool first = true;
+    for(detail::thread_block* b = detail::blocks.load(std::memory_order_acquire); b; b = b->next) {
+        for(const timer_event &e : b->events) {
+            std::fprintf(out, "%s\n{\"name\":", first ? "" : ",");
+            detail::write_json_string(out, e.name);
+            std::fprintf(out, ",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+                b->thread_index, e.start_ns / 1e3, e.duration_ns / 1e3);
+            first = false;
+        }
+    }
+
+    std::fprintf(out, "\n],\"otherData\":{");
+    for(std::size_t i = 0; i < static_cast<std::size_t>(category::count); i++) {
+        const totals t = snapshot(static_cast<category>(i));
+        std::fprintf(out, "%s\"%s\":\"calls=%llu elements=%llu flops=%llu\"", i ? "," : "", category_names[i],
+            static_cast<unsigned long long>(t.calls), static_cast<unsigned long long>(t.elements),
+            static_cast<unsigned long long>(t.flops));
+    }
+    std::fprintf(out, "}}\n");
+    return std::fclose(out) == 0;
+}
+
+}
+}
+
+/* Hooks are skipped during constant evaluation, so constexpr functions stay constexpr. */
+#define MTP_PROFILE_OP(cat, elements, flops) \
+    do { \
+        if(!MTP_IS_CONSTANT_EVALUATED()) \
+            ::mtp::profile::record(::mtp::profile::category::cat, (elements), (flops)); \
+    } while(0)
+
+#define MTP_PROFILE_SCOPE(name) ::mtp::profile::scoped_timer MTP_PROFILE_CONCAT(mtp_profile_scope_, __LINE__)(name)
+
+#else
+
+#define MTP_PROFILE_OP(cat, elements, flops) do {} while(0)
+#define MTP_PROFILE_SCOPE(name) do {} while(0)
+
+#endif
+
+#endif
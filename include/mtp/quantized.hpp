@@ -0,0 +1,342 @@
+#ifndef QUANTIZED_HPP
+#define QUANTIZED_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+#include "matrix.hpp"
+#include "simd.hpp"
+
+namespace mtp {
+
+/*
+* Row y of a dynamic_matrix is the contiguous run data[y*n .. y*n+n), as addressed by get(x, y).
+* All quantized kernels below follow that layout: n is the row length, m is the row count.
+*/
+
+enum class quant_granularity {
+    per_tensor, /* one scale and zero point for the whole matrix */
+    per_row     /* one scale and zero point per row */
+};
+
+template <typename T>
+struct quant_limits {
+    static_assert(std::is_same_v<T, std::int8_t> || std::is_same_v<T, std::int16_t>,
+        "Quantized matrices support only int8_t and int16_t.");
+
+    /* The lowest value is excluded so the range stays symmetric (required by the int8 sign trick). */
+    static constexpr std::int32_t min = -static_cast<std::int32_t>(std::numeric_limits<T>::max());
+    static constexpr std::int32_t max = std::numeric_limits<T>::max();
+};
+
+/**
+* @brief Quantized matrix. real = scale * (q - zero_point).
+* The values, scales and zero points each carry the inline buffer of DynamicDataContainer
+* (3 x MTP_SMALL_BUFFER_BYTES per object) even when the values live on the heap.
+* @arg T - int8_t or int16_t.
+*/
+template <typename T>
+struct quantized_matrix : public dynamic_matrix<T> {
+    quant_granularity granularity = quant_granularity::per_tensor;
+    DynamicDataContainer<float> scales;             /* 1 or m entries */
+    DynamicDataContainer<std::int32_t> zero_points; /* 1 or m entries */
+
+    quantized_matrix(const std::size_t &width, const std::size_t &rows, const quant_granularity &g = quant_granularity::per_tensor) :
+        dynamic_matrix<T>(width, rows), granularity(g),
+        scales(g == quant_granularity::per_row ? rows : 1, 1.0f),
+        zero_points(g == quant_granularity::per_row ? rows : 1, std::int32_t(0))
+    {
+
+    }
+
+    inline float scale(const std::size_t &row) const {
+        return scales.data[granularity == quant_granularity::per_row ? row : 0];
+    }
+
+    inline std::int32_t zero_point(const std::size_t &row) const {
+        return zero_points.data[granularity == quant_granularity::per_row ? row : 0];
+    }
+};
+
+using quantized_matrix8  = quantized_matrix<std::int8_t>;
+using quantized_matrix16 = quantized_matrix<std::int16_t>;
+
+namespace detail {
+
+template <typename T>
+static inline void quant_params(float lo, float hi, const bool &symmetric, float &scale, std::int32_t &zero_point) {
+    constexpr std::int32_t qmin = quant_limits<T>::min;
+    constexpr std::int32_t qmax = quant_limits<T>::max;
+
+    /* zero must be exactly representable */
+    lo = std::min(lo, 0.0f);
+    hi = std::max(hi, 0.0f);
+
+    if(symmetric) {
+        const float absmax = std::max(-lo, hi);
+        scale = absmax > 0.0f ? absmax / static_cast<float>(qmax) : 1.0f;
+        zero_point = 0;
+        return;
+    }
+
+    scale = hi > lo ? (hi - lo) / static_cast<float>(qmax - qmin) : 1.0f;
+    const long zp = std::lround(static_cast<float>(qmin) - lo / scale);
+    zero_point = static_cast<std::int32_t>(std::clamp<long>(zp, qmin, qmax));
+}
+
+template <typename T>
+static inline void quantize_row(const float* src, T* dst, const std::size_t &count, const float &scale, const std::int32_t &zero_point) {
+    const float inv = 1.0f / scale;
+    for(std::size_t i = 0; i < count; i++) {
+        const long q = std::lround(src[i] * inv) + zero_point;
+        dst[i] = static_cast<T>(std::clamp<long>(q, quant_limits<T>::min, quant_limits<T>::max));
+    }
+}
+
+#if defined(MTP_AVX2)
+static inline std::int32_t hsum_epi32(const __m256i &v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+/* int8 x int8 -> int32 on 32 lanes. b must not contain -128. */
+static inline __m256i madd_s8(const __m256i &acc, const __m256i &ua, const __m256i &a, const __m256i &b) {
+    const __m256i sb = _mm256_sign_epi8(b, a); /* moves the sign of a onto b, ua = |a| */
+#if defined(MTP_AVXVNNI)
+    return _mm256_dpbusd_avx_epi32(acc, ua, sb);
+#elif defined(MTP_AVX512VNNI)
+    return _mm256_dpbusd_epi32(acc, ua, sb);
+#else
+    const __m256i p16 = _mm256_maddubs_epi16(ua, sb);
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(p16, _mm256_set1_epi16(1)));
+#endif
+}
+#endif
+
+/* 4 dot products of one row of A with 4 rows of Bt. */
+static inline void dot4(const std::int8_t* a, const std::int8_t* const b[4], const std::size_t &k, std::int32_t out[4]) {
+    std::size_t i = 0;
+#if defined(MTP_AVX2)
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    for(; i + 32 <= k; i += 32) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i ua = _mm256_sign_epi8(va, va);
+        acc0 = madd_s8(acc0, ua, va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[0] + i)));
+        acc1 = madd_s8(acc1, ua, va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[1] + i)));
+        acc2 = madd_s8(acc2, ua, va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[2] + i)));
+        acc3 = madd_s8(acc3, ua, va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[3] + i)));
+    }
+    out[0] = hsum_epi32(acc0); out[1] = hsum_epi32(acc1);
+    out[2] = hsum_epi32(acc2); out[3] = hsum_epi32(acc3);
+#else
+    out[0] = out[1] = out[2] = out[3] = 0;
+#endif
+    for(; i < k; i++) {
+        const std::int32_t va = a[i];
+        out[0] += va * b[0][i]; out[1] += va * b[1][i];
+        out[2] += va * b[2][i]; out[3] += va * b[3][i];
+    }
+}
+
+static inline void dot4(const std::int16_t* a, const std::int16_t* const b[4], const std::size_t &k, std::int32_t out[4]) {
+    std::size_t i = 0;
+#if defined(MTP_AVX2)
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    for(; i + 16 <= k; i += 16) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[0] + i))));
+        acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[1] + i))));
+        acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[2] + i))));
+        acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[3] + i))));
+    }
+    out[0] = hsum_epi32(acc0); out[1] = hsum_epi32(acc1);
+    out[2] = hsum_epi32(acc2); out[3] = hsum_epi32(acc3);
+#else
+    out[0] = out[1] = out[2] = out[3] = 0;
+#endif
+    for(; i < k; i++) {
+        const std::int32_t va = a[i];
+        out[0] += va * b[0][i]; out[1] += va * b[1][i];
+        out[2] += va * b[2][i]; out[3] += va * b[3][i];
+    }
+}
+
+/* One dot product, used for the columns left over by dot4. */
+static inline std::int32_t dot1(const std::int8_t* a, const std::int8_t* b, const std::size_t &k) {
+    std::size_t i = 0;
+    std::int32_t sum = 0;
+#if defined(MTP_AVX2)
+    __m256i acc = _mm256_setzero_si256();
+    for(; i + 32 <= k; i += 32) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        acc = madd_s8(acc, _mm256_sign_epi8(va, va), va, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+    }
+    sum = hsum_epi32(acc);
+#endif
+    for(; i < k; i++) sum += static_cast<std::int32_t>(a[i]) * b[i];
+    return sum;
+}
+
+static inline std::int32_t dot1(const std::int16_t* a, const std::int16_t* b, const std::size_t &k) {
+    std::size_t i = 0;
+    std::int32_t sum = 0;
+#if defined(MTP_AVX2)
+    __m256i acc = _mm256_setzero_si256();
+    for(; i + 16 <= k; i += 16) {
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+    }
+    sum = hsum_epi32(acc);
+#endif
+    for(; i < k; i++) sum += static_cast<std::int32_t>(a[i]) * b[i];
+    return sum;
+}
+
+/* Whether the int8 sign trick would see -128 in b (never produced by quantize()). */
+template <typename T>
+static inline bool has_lowest(const T* data, const std::size_t &count) {
+    if constexpr(std::is_same_v<T, std::int8_t>) {
+        for(std::size_t i = 0; i < count; i++) if(data[i] == std::numeric_limits<T>::min()) return true;
+    }
+    return false;
+}
+
+template <typename T>
+static inline std::int32_t row_sum(const T* row, const std::size_t &count) {
+    std::int32_t sum = 0;
+    for(std::size_t i = 0; i < count; i++) sum += row[i];
+    return sum;
+}
+
+}
+
+/**
+* @brief Quantizes a float matrix.
+* @param src source matrix
+* @param granularity per-tensor or per-row parameters
+* @param symmetric forces zero_point = 0
+*/
+template <typename T, std::size_t Inline>
+quantized_matrix<T> quantize(const dynamic_matrix<float, Inline> &src, const quant_granularity &granularity = quant_granularity::per_tensor,
+    const bool &symmetric = false)
+{
+    quantized_matrix<T> result(src.n, src.m, granularity);
+
+    if(granularity == quant_granularity::per_tensor) {
+        float lo = 0.0f, hi = 0.0f;
+        for(std::size_t i = 0; i < src.size; i++) {
+            lo = std::min(lo, src.data[i]);
+            hi = std::max(hi, src.data[i]);
+        }
+        detail::quant_params<T>(lo, hi, symmetric, result.scales.data[0], result.zero_points.data[0]);
+    }
+
+    for(std::size_t y = 0; y < src.m; y++) {
+        const float* row = src.data + y*src.n;
+        if(granularity == quant_granularity::per_row) {
+            float lo = 0.0f, hi = 0.0f;
+            for(std::size_t x = 0; x < src.n; x++) {
+                lo = std::min(lo, row[x]);
+                hi = std::max(hi, row[x]);
+            }
+            detail::quant_params<T>(lo, hi, symmetric, result.scales.data[y], result.zero_points.data[y]);
+        }
+        detail::quantize_row(row, result.data + y*src.n, src.n, result.scale(y), result.zero_point(y));
+    }
+    return result;
+}
+
+/**
+* @brief Converts a quantized matrix back to float.
+*/
+template <typename T>
+dynamic_matrix<float> dequantize(const quantized_matrix<T> &src) {
+    dynamic_matrix<float> result(src.n, src.m);
+    for(std::size_t y = 0; y < src.m; y++) {
+        const float scale = src.scale(y);
+        const std::int32_t zero_point = src.zero_point(y);
+        for(std::size_t x = 0; x < src.n; x++) {
+            result.data[y*src.n+x] = scale * static_cast<float>(src.data[y*src.n+x] - zero_point);
+        }
+    }
+    return result;
+}
+
+/**
+* @brief Raw integer product C = A * transpose(Bt) with int32 accumulation. Zero points are ignored.
+* @param a A matrix, m rows of length k
+* @param bt B stored transposed, one row of length k per output column
+* @param c output, resized to bt.m x a.m when its size differs or its buffer is shared
+*
+* Bt layout keeps both operands contiguous along k (weights stored as [out, in]).
+* The int8 kernel uses vpmaddubsw/vpmaddwd (or vpdpbusd with AVX-VNNI), int16 uses vpmaddwd.
+* The int8 kernel needs Bt in [-127, 127] as produced by quantize(), a Bt holding -128 is
+* multiplied by a plain scalar loop instead.
+* int16 inputs may overflow the int32 accumulator for long rows with full-range values.
+*/
+template <typename T, std::size_t Inline, std::size_t CInline>
+void qgemm(const dynamic_matrix<T, Inline> &a, const dynamic_matrix<T, Inline> &bt, dynamic_matrix<std::int32_t, CInline> &c) {
+    const std::size_t k = a.n;
+    if(c.n != bt.m || c.m != a.m || c.is_shared()) c.resize(bt.m, a.m);
+
+    if(detail::has_lowest(bt.data, bt.n*bt.m)) {
+        for(std::size_t y = 0; y < a.m; y++) {
+            for(std::size_t x = 0; x < bt.m; x++) {
+                std::int32_t sum = 0;
+                for(std::size_t i = 0; i < k; i++) sum += static_cast<std::int32_t>(a.data[y*k+i]) * bt.data[x*k+i];
+                c.data[y*c.n+x] = sum;
+            }
+        }
+        return;
+    }
+
+    for(std::size_t y = 0; y < a.m; y++) {
+        const T* ar = a.data + y*k;
+        std::int32_t* cr = c.data + y*c.n;
+
+        std::size_t x = 0;
+        for(; x + 4 <= bt.m; x += 4) {
+            const T* const br[4] = {bt.data + x*k, bt.data + (x+1)*k, bt.data + (x+2)*k, bt.data + (x+3)*k};
+            detail::dot4(ar, br, k, cr + x);
+        }
+        for(; x < bt.m; x++) cr[x] = detail::dot1(ar, bt.data + x*k, k);
+    }
+} /* O(M*N*K) */
+
+/**
+* @brief Dequantized product C = A * transpose(Bt).
+*
+* real(A)*real(Bt)^T = sa*sb * (sum qa*qb - zb*sum qa - za*sum qb + k*za*zb)
+*/
+template <typename T>
+dynamic_matrix<float> qgemm(const quantized_matrix<T> &a, const quantized_matrix<T> &bt) {
+    const std::size_t k = a.n;
+    dynamic_matrix<std::int32_t> acc(bt.m, a.m);
+    qgemm<T>(a, bt, acc);
+
+    DynamicDataContainer<std::int32_t> bsums(bt.m);
+    for(std::size_t x = 0; x < bt.m; x++) bsums.data[x] = detail::row_sum(bt.data + x*k, k);
+
+    dynamic_matrix<float> result(bt.m, a.m);
+    for(std::size_t y = 0; y < a.m; y++) {
+        const std::int32_t asum = detail::row_sum(a.data + y*k, k);
+        const std::int32_t za = a.zero_point(y);
+        const float sa = a.scale(y);
+
+        for(std::size_t x = 0; x < bt.m; x++) {
+            const std::int32_t zb = bt.zero_point(x);
+            const std::int64_t v = static_cast<std::int64_t>(acc.data[y*bt.m+x]) -
+                static_cast<std::int64_t>(zb)*asum - static_cast<std::int64_t>(za)*bsums.data[x] +
+                static_cast<std::int64_t>(k)*za*zb;
+            result.data[y*bt.m+x] = sa * bt.scale(x) * static_cast<float>(v);
+        }
+    }
+    return result;
+}
+
+}
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef QUAT_HPP
 #define QUAT_HPP
 
+#include <cmath>
+
 namespace mtp {
 
 struct quat {
@@ -14,8 +16,50 @@ struct quat {
             w * q.z + x * q.y - y * q.x + z * q.w
         };
     }
+
+    /* component-wise, used by blending */
+    quat operator+(const quat& q) const { return {x + q.x, y + q.y, z + q.z, w + q.w}; }
+    quat operator-(const quat& q) const { return {x - q.x, y - q.y, z - q.z, w - q.w}; }
+    quat operator*(const float& s) const { return {x * s, y * s, z * s, w * s}; }
+    quat operator-() const { return {-x, -y, -z, -w}; }
 };
 
+static inline float dot(const quat &a, const quat &b) {
+    return a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w;
+}
+
+static inline quat normalize(const quat &q) {
+    const float length = std::sqrt(dot(q, q));
+    return length > 0.0f ? q * (1.0f / length) : quat{0.0f, 0.0f, 0.0f, 1.0f};
+}
+
+/**
+* @brief Normalized linear interpolation along the shorter arc. Cheaper than slerp, not constant speed.
+* @param factor value within range 0.0 - 1.0
+*/
+static inline quat nlerp(const quat &a, const quat &b, const float &factor) {
+    const quat end = dot(a, b) < 0.0f ? -b : b;
+    return normalize(a + (end - a) * factor);
+}
+
+/**
+* @brief Spherical linear interpolation along the shorter arc of two unit quaternions.
+* @param factor value within range 0.0 - 1.0
+*/
+static inline quat slerp(const quat &a, const quat &b, const float &factor) {
+    float d = dot(a, b);
+    quat end = b;
+    if(d < 0.0f) {
+        end = -b;
+        d = -d;
+    }
+    if(d > 0.9995f) return normalize(a + (end - a) * factor); /* nearly parallel, sin(theta) -> 0 */
+
+    const float theta = std::acos(d);
+    const float inv = 1.0f / std::sin(theta);
+    return a * (std::sin((1.0f - factor) * theta) * inv) + end * (std::sin(factor * theta) * inv);
+}
+
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,326 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace mtp {
+
+/*
+* Bilinear and trilinear sampling. Coordinates are in element units with element centers on
+* integer coordinates: sampling at (1, 2) returns get(1, 2) exactly.
+* 2D grids: dynamic_matrix (width n) and matrix<T, N, M> (width N), element (x, y) at y*width + x.
+* 3D grids: dynamic_matrix3d and matrix3d, element (x, y, z) at index(x, y, z).
+*/
+
+enum class border_mode {
+    clamp, /* coordinates outside of the grid repeat the edge elements */
+    wrap   /* the grid tiles space */
+};
+
+/* Raw views of the containers, the samplers below work on these. */
+template <typename T>
+struct grid2d_view {
+    const T* data;
+    std::size_t w, h;
+};
+
+template <typename T>
+struct grid3d_view {
+    const T* data;
+    std::size_t w, h, v;
+};
+
+template <typename T, std::size_t Inline>
+inline grid2d_view<T> grid_view(const dynamic_matrix<T, Inline> &m) { return {m.data, m.n, m.m}; }
+
+template <typename T, std::size_t N, std::size_t M>
+inline grid2d_view<T> grid_view(const matrix<T, N, M> &m) { return {m.data, N, M}; }
+
+template <typename T, std::size_t Inline>
+inline grid3d_view<T> grid_view(const dynamic_matrix3d<T, Inline> &m) { return {m.data, m.w, m.h, m.v}; }
+
+template <typename T, std::size_t W, std::size_t H, std::size_t V>
+inline grid3d_view<T> grid_view(const matrix3d<T, W, H, V> &m) { return {m.data, W, H, V}; }
+
+/* Interpolation happens in double for double grids, float otherwise. */
+template <typename T>
+using sample_weight_t = std::conditional_t<std::is_same_v<T, double>, double, float>;
+
+/* Two neighbouring elements along one axis and the weight of the second one. */
+struct sample_axis {
+    std::size_t i0, i1;
+    float f;
+};
+
+namespace detail {
+
+inline sample_axis resolve_axis(const float &u, const std::size_t &n, const border_mode &mode) {
+    const float fl = std::floor(u);
+    const float f = u - fl;
+    const long long i = static_cast<long long>(fl);
+    const long long last = static_cast<long long>(n) - 1;
+
+    if(mode == border_mode::clamp) {
+        return {static_cast<std::size_t>(std::clamp(i, 0LL, last)), static_cast<std::size_t>(std::clamp(i + 1, 0LL, last)), f};
+    }
+    const long long size = static_cast<long long>(n);
+    const long long i0 = ((i % size) + size) % size;
+    return {static_cast<std::size_t>(i0), static_cast<std::size_t>(i0 == last ? 0 : i0 + 1), f};
+}
+
+#if defined(MTP_AVX2)
+/* 8 lanes of resolve_axis for float grids. */
+inline void resolve_axis8(const __m256 &u, const int &n, const border_mode &mode, __m256i &i0, __m256i &i1, __m256 &f) {
+    const __m256i last = _mm256_set1_epi32(n - 1);
+    if(mode == border_mode::clamp) {
+        const __m256 fl = _mm256_floor_ps(u);
+        f = _mm256_sub_ps(u, fl);
+        const __m256i i = _mm256_cvttps_epi32(fl);
+        i0 = _mm256_max_epi32(_mm256_min_epi32(i, last), _mm256_setzero_si256());
+        i1 = _mm256_max_epi32(_mm256_min_epi32(_mm256_add_epi32(i, _mm256_set1_epi32(1)), last), _mm256_setzero_si256());
+        return;
+    }
+    const __m256 size = _mm256_set1_ps(static_cast<float>(n));
+    __m256 uw = _mm256_sub_ps(u, _mm256_mul_ps(size, _mm256_floor_ps(_mm256_div_ps(u, size))));
+    uw = _mm256_andnot_ps(_mm256_cmp_ps(uw, size, _CMP_GE_OQ), uw); /* -eps rounds up to n */
+    const __m256 fl = _mm256_floor_ps(uw);
+    f = _mm256_sub_ps(uw, fl);
+    i0 = _mm256_min_epi32(_mm256_max_epi32(_mm256_cvttps_epi32(fl), _mm256_setzero_si256()), last);
+    i1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(i0, last), _mm256_add_epi32(i0, _mm256_set1_epi32(1)));
+}
+
+inline __m256 lerp8(const __m256 &a, const __m256 &b, const __m256 &f) {
+#if defined(MTP_FMA)
+    return _mm256_fmadd_ps(f, _mm256_sub_ps(b, a), a);
+#else
+    return _mm256_add_ps(a, _mm256_mul_ps(f, _mm256_sub_ps(b, a)));
+#endif
+}
+#endif
+
+/* Samples per parallel chunk */
+constexpr std::size_t sample_grain = 4096;
+
+/* AVX2 gathers address the grid with int32 offsets, larger grids take the scalar path. */
+constexpr bool gather_addressable(const std::size_t &elements) {
+    return elements <= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max());
+}
+
+}
+
+/**
+* @brief Bilinear sample of a 2D grid.
+* @param x column coordinate
+* @param y row coordinate
+*/
+template <typename T>
+inline T sample_bilinear(const grid2d_view<T> &g, const float &x, const float &y, const border_mode &mode = border_mode::clamp) {
+    using F = sample_weight_t<T>;
+    const sample_axis ax = detail::resolve_axis(x, g.w, mode);
+    const sample_axis ay = detail::resolve_axis(y, g.h, mode);
+
+    const T* r0 = g.data + ay.i0*g.w;
+    const T* r1 = g.data + ay.i1*g.w;
+    const F top    = F(r0[ax.i0]) + F(ax.f) * (F(r0[ax.i1]) - F(r0[ax.i0]));
+    const F bottom = F(r1[ax.i0]) + F(ax.f) * (F(r1[ax.i1]) - F(r1[ax.i0]));
+    return static_cast<T>(top + F(ay.f) * (bottom - top));
+}
+
+/**
+* @brief Trilinear sample of a 3D grid.
+* @param x Width
+* @param y Height
+* @param z Volume
+*/
+template <typename T>
+inline T sample_trilinear(const grid3d_view<T> &g, const float &x, const float &y, const float &z, const border_mode &mode = border_mode::clamp) {
+    using F = sample_weight_t<T>;
+    const sample_axis ax = detail::resolve_axis(x, g.w, mode);
+    const sample_axis ay = detail::resolve_axis(y, g.h, mode);
+    const sample_axis az = detail::resolve_axis(z, g.v, mode);
+    const std::size_t layer = g.w*g.v;
+
+    auto row = [&](const std::size_t &yi, const std::size_t &zi) {
+        const T* r = g.data + yi*layer + zi*g.w;
+        return F(r[ax.i0]) + F(ax.f) * (F(r[ax.i1]) - F(r[ax.i0]));
+    };
+    const F y0 = row(ay.i0, az.i0) + F(az.f) * (row(ay.i0, az.i1) - row(ay.i0, az.i0));
+    const F y1 = row(ay.i1, az.i0) + F(az.f) * (row(ay.i1, az.i1) - row(ay.i1, az.i0));
+    return static_cast<T>(y0 + F(ay.f) * (y1 - y0));
+}
+
+template <typename Grid>
+inline auto sample_bilinear(const Grid &m, const float &x, const float &y, const border_mode &mode = border_mode::clamp) {
+    return sample_bilinear(grid_view(m), x, y, mode);
+}
+
+template <typename Grid>
+inline auto sample_trilinear(const Grid &m, const float &x, const float &y, const float &z, const border_mode &mode = border_mode::clamp) {
+    return sample_trilinear(grid_view(m), x, y, z, mode);
+}
+
+/**
+* @brief Bilinear samples at SoA coordinates. Float grids gather 8 samples per step with AVX2
+* (grids of up to 2^31 - 1 elements, larger ones are sampled one by one).
+* @param out one value per coordinate pair
+* @param parallel splits the samples between hardware threads
+*/
+template <typename T>
+void sample_bilinear(const grid2d_view<T> &g, const float* xs, const float* ys, const std::size_t &count, T* out,
+    const border_mode &mode = border_mode::clamp, const bool &parallel = false)
+{
+    parallel_for_chunks(plan_chunks(count, detail::sample_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::size_t i = begin;
+#if defined(MTP_AVX2)
+        if constexpr(std::is_same_v<T, float>) {
+            const __m256i w = _mm256_set1_epi32(static_cast<int>(g.w));
+            const std::size_t simd_end = detail::gather_addressable(g.w*g.h) ? end : begin;
+            for(; i + 8 <= simd_end; i += 8) {
+                __m256i x0, x1, y0, y1;
+                __m256 fx, fy;
+                detail::resolve_axis8(_mm256_loadu_ps(xs + i), static_cast<int>(g.w), mode, x0, x1, fx);
+                detail::resolve_axis8(_mm256_loadu_ps(ys + i), static_cast<int>(g.h), mode, y0, y1, fy);
+                const __m256i r0 = _mm256_mullo_epi32(y0, w), r1 = _mm256_mullo_epi32(y1, w);
+
+                const __m256 top = detail::lerp8(_mm256_i32gather_ps(g.data, _mm256_add_epi32(r0, x0), 4),
+                                                 _mm256_i32gather_ps(g.data, _mm256_add_epi32(r0, x1), 4), fx);
+                const __m256 bottom = detail::lerp8(_mm256_i32gather_ps(g.data, _mm256_add_epi32(r1, x0), 4),
+                                                    _mm256_i32gather_ps(g.data, _mm256_add_epi32(r1, x1), 4), fx);
+                _mm256_storeu_ps(out + i, detail::lerp8(top, bottom, fy));
+            }
+        }
+#endif
+        for(; i < end; i++) out[i] = sample_bilinear(g, xs[i], ys[i], mode);
+    });
+}
+
+/**
+* @brief Trilinear samples at SoA coordinates. Float grids gather 8 samples per step with AVX2
+* (grids of up to 2^31 - 1 elements, larger ones are sampled one by one).
+* @param out one value per coordinate triple
+* @param parallel splits the samples between hardware threads
+*/
+template <typename T>
+void sample_trilinear(const grid3d_view<T> &g, const float* xs, const float* ys, const float* zs, const std::size_t &count, T* out,
+    const border_mode &mode = border_mode::clamp, const bool &parallel = false)
+{
+    parallel_for_chunks(plan_chunks(count, detail::sample_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::size_t i = begin;
+#if defined(MTP_AVX2)
+        if constexpr(std::is_same_v<T, float>) {
+            const __m256i w = _mm256_set1_epi32(static_cast<int>(g.w));
+            const __m256i layer = _mm256_set1_epi32(static_cast<int>(g.w*g.v));
+            const std::size_t simd_end = detail::gather_addressable(g.w*g.h*g.v) ? end : begin;
+            for(; i + 8 <= simd_end; i += 8) {
+                __m256i x0, x1, y0, y1, z0, z1;
+                __m256 fx, fy, fz;
+                detail::resolve_axis8(_mm256_loadu_ps(xs + i), static_cast<int>(g.w), mode, x0, x1, fx);
+                detail::resolve_axis8(_mm256_loadu_ps(ys + i), static_cast<int>(g.h), mode, y0, y1, fy);
+                detail::resolve_axis8(_mm256_loadu_ps(zs + i), static_cast<int>(g.v), mode, z0, z1, fz);
+                y0 = _mm256_mullo_epi32(y0, layer); y1 = _mm256_mullo_epi32(y1, layer);
+                z0 = _mm256_mullo_epi32(z0, w);     z1 = _mm256_mullo_epi32(z1, w);
+
+                auto row = [&](const __m256i &yo, const __m256i &zo) {
+                    const __m256i base = _mm256_add_epi32(yo, zo);
+                    return detail::lerp8(_mm256_i32gather_ps(g.data, _mm256_add_epi32(base, x0), 4),
+                                         _mm256_i32gather_ps(g.data, _mm256_add_epi32(base, x1), 4), fx);
+                };
+                const __m256 a = detail::lerp8(row(y0, z0), row(y0, z1), fz);
+                const __m256 b = detail::lerp8(row(y1, z0), row(y1, z1), fz);
+                _mm256_storeu_ps(out + i, detail::lerp8(a, b, fy));
+            }
+        }
+#endif
+        for(; i < end; i++) out[i] = sample_trilinear(g, xs[i], ys[i], zs[i], mode);
+    });
+}
+
+/**
+* @brief Precomputed neighbours and weights of a regular grid along one axis.
+* Destination element i samples the source at (i + 0.5) * src / dst - 0.5 (centers aligned).
+*/
+struct resample_axis {
+    std::vector<sample_axis> taps;
+
+    resample_axis(const std::size_t &src, const std::size_t &dst, const border_mode &mode = border_mode::clamp) : taps(dst) {
+        const double scale = static_cast<double>(src) / static_cast<double>(dst);
+        for(std::size_t i = 0; i < dst; i++) {
+            taps[i] = detail::resolve_axis(static_cast<float>((static_cast<double>(i) + 0.5) * scale - 0.5), src, mode);
+        }
+    }
+};
+
+/**
+* @brief Resamples a 2D grid into dst (its size is kept) with per-axis precomputed weights.
+*/
+template <typename T, std::size_t Inline>
+void resample(const grid2d_view<T> &src, dynamic_matrix<T, Inline> &dst, const border_mode &mode = border_mode::clamp, const bool &parallel = false) {
+    using F = sample_weight_t<T>;
+    const resample_axis ax(src.w, dst.n, mode), ay(src.h, dst.m, mode);
+    if(dst.is_shared()) dst.resize(dst.n, dst.m);
+
+    parallel_for_chunks(plan_chunks(dst.m, 1, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for(std::size_t y = begin; y < end; y++) {
+            const sample_axis &ty = ay.taps[y];
+            const T* r0 = src.data + ty.i0*src.w;
+            const T* r1 = src.data + ty.i1*src.w;
+            T* out = dst.data + y*dst.n;
+            for(std::size_t x = 0; x < dst.n; x++) {
+                const sample_axis &tx = ax.taps[x];
+                const F top    = F(r0[tx.i0]) + F(tx.f) * (F(r0[tx.i1]) - F(r0[tx.i0]));
+                const F bottom = F(r1[tx.i0]) + F(tx.f) * (F(r1[tx.i1]) - F(r1[tx.i0]));
+                out[x] = static_cast<T>(top + F(ty.f) * (bottom - top));
+            }
+        }
+    });
+}
+
+/**
+* @brief Resamples a 3D grid into dst (its size is kept) with per-axis precomputed weights.
+* Every destination row first blends the four source rows along y and z, then interpolates along x.
+*/
+template <typename T, std::size_t Inline>
+void resample(const grid3d_view<T> &src, dynamic_matrix3d<T, Inline> &dst, const border_mode &mode = border_mode::clamp, const bool &parallel = false) {
+    using F = sample_weight_t<T>;
+    const resample_axis ax(src.w, dst.w, mode), ay(src.h, dst.h, mode), az(src.v, dst.v, mode);
+    if(dst.is_shared()) dst.resize(dst.w, dst.h, dst.v);
+    const std::size_t layer = src.w*src.v;
+
+    parallel_for_chunks(plan_chunks(dst.h*dst.v, 1, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::vector<F> blended(src.w);
+        for(std::size_t row = begin; row < end; row++) {
+            const std::size_t y = row / dst.v, z = row % dst.v;
+            const sample_axis &ty = ay.taps[y], &tz = az.taps[z];
+            const T* a = src.data + ty.i0*layer + tz.i0*src.w;
+            const T* b = src.data + ty.i0*layer + tz.i1*src.w;
+            const T* c = src.data + ty.i1*layer + tz.i0*src.w;
+            const T* d = src.data + ty.i1*layer + tz.i1*src.w;
+            const F fy = F(ty.f), fz = F(tz.f);
+
+            /* contiguous pass over the source row, vectorizes */
+            for(std::size_t x = 0; x < src.w; x++) {
+                const F ab = F(a[x]) + fz * (F(b[x]) - F(a[x]));
+                const F cd = F(c[x]) + fz * (F(d[x]) - F(c[x]));
+                blended[x] = ab + fy * (cd - ab);
+            }
+
+            T* out = dst.data + dst.index(0, y, z);
+            for(std::size_t x = 0; x < dst.w; x++) {
+                const sample_axis &tx = ax.taps[x];
+                out[x] = static_cast<T>(blended[tx.i0] + F(tx.f) * (blended[tx.i1] - blended[tx.i0]));
+            }
+        }
+    });
+}
+
+}
+
+#endif
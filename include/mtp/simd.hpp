@@ -0,0 +1,28 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+/* 
+* Instruction set detection for the vectorized kernels.
+* Kernels are selected at compile time from the target flags (-mavx2, -mfma, -march=native ...).
+* Define MTP_NO_SIMD to force the scalar fallbacks.
+*/
+
+#if !defined(MTP_NO_SIMD)
+    #if defined(__AVX2__)
+        #define MTP_AVX2 1
+    #endif
+    #if defined(__FMA__)
+        #define MTP_FMA 1
+    #endif
+    #if defined(__AVXVNNI__)
+        #define MTP_AVXVNNI 1
+    #elif defined(__AVX512VNNI__) && defined(__AVX512VL__)
+        #define MTP_AVX512VNNI 1
+    #endif
+#endif
+
+#if defined(MTP_AVX2)
+    #include <immintrin.h>
+#endif
+
+#endif
@@ -0,0 +1,376 @@
+#ifndef SKINNING_HPP
+#define SKINNING_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include "matrix.hpp"
+#include "quat.hpp"
+#include "pipeline.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace mtp {
+
+/*
+* Vertex skinning over structure of arrays streams.
+* Linear blend skinning takes bone matrices in the layout of transform.hpp (column-major, translation
+* in data[12..14]), dual quaternion skinning unit dual quaternions. The weights of a vertex should sum
+* to 1. Normals go through the 3x3 part of the blended matrix and are renormalized (exact for rigid
+* bones and uniform scale), dual quaternion skinning rotates them.
+*/
+
+/* Rigid transform: real is the rotation, dual = 0.5 * translation * real. */
+struct dual_quat {
+    quat real = {0.0f, 0.0f, 0.0f, 1.0f};
+    quat dual = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    dual_quat()
+    {
+
+    }
+
+    dual_quat(const quat &real, const quat &dual) : real(real), dual(dual)
+    {
+
+    }
+
+    /* rotation followed by translation */
+    dual_quat(const quat &rotation, const vector<float, 3> &t) : real(rotation)
+    {
+        const quat &r = rotation;
+        dual = {
+            0.5f * ( r.w*t.data[0] + t.data[1]*r.z - t.data[2]*r.y),
+            0.5f * ( r.w*t.data[1] + t.data[2]*r.x - t.data[0]*r.z),
+            0.5f * ( r.w*t.data[2] + t.data[0]*r.y - t.data[1]*r.x),
+            0.5f * (-t.data[0]*r.x - t.data[1]*r.y - t.data[2]*r.z)
+        };
+    }
+
+    vector<float, 3> translation() const {
+        const quat &r = real, &d = dual;
+        return vector<float, 3>(
+            2.0f * (r.w*d.x - d.w*r.x + r.y*d.z - r.z*d.y),
+            2.0f * (r.w*d.y - d.w*r.y + r.z*d.x - r.x*d.z),
+            2.0f * (r.w*d.z - d.w*r.z + r.x*d.y - r.y*d.x));
+    }
+};
+
+/**
+* @brief Dual quaternion of a rigid bone matrix (rotation and translation, no scale).
+*/
+static inline dual_quat to_dual_quat(const matrix<float, 4, 4> &bone) {
+    const float* m = bone.data; /* R(row, col) = m[col*4 + row] */
+    const float trace = m[0] + m[5] + m[10];
+    quat q;
+    if(trace > 0.0f) {
+        const float s = 0.5f / std::sqrt(trace + 1.0f);
+        q = {(m[6] - m[9]) * s, (m[8] - m[2]) * s, (m[1] - m[4]) * s, 0.25f / s};
+    } else if(m[0] > m[5] && m[0] > m[10]) {
+        const float s = 2.0f * std::sqrt(1.0f + m[0] - m[5] - m[10]);
+        q = {0.25f * s, (m[4] + m[1]) / s, (m[8] + m[2]) / s, (m[6] - m[9]) / s};
+    } else if(m[5] > m[10]) {
+        const float s = 2.0f * std::sqrt(1.0f + m[5] - m[0] - m[10]);
+        q = {(m[4] + m[1]) / s, 0.25f * s, (m[9] + m[6]) / s, (m[8] - m[2]) / s};
+    } else {
+        const float s = 2.0f * std::sqrt(1.0f + m[10] - m[0] - m[5]);
+        q = {(m[8] + m[2]) / s, (m[9] + m[6]) / s, 0.25f * s, (m[1] - m[4]) / s};
+    }
+    return dual_quat(normalize(q), vector<float, 3>(m[12], m[13], m[14]));
+}
+
+/**
+* @brief Bone influences of every vertex as K joint index and K weight streams:
+* joints[k][v] and weights[k][v] belong to influence k of vertex v. The palette is never read
+* for a zero weight, so unused slots may hold any joint index (e.g. a 0xFFFF sentinel).
+* @arg K - Influences per vertex, 1 to 8 (typically 4 or 8).
+*/
+template <typename T, std::size_t K>
+struct skin_influences {
+    static_assert(K >= 1 && K <= 8, "Skinning supports 1 to 8 influences per vertex.");
+    const std::uint16_t* joints[K];
+    const T* weights[K];
+};
+
+/* Output streams of skinned positions or normals. */
+template <typename T>
+struct skin_output {
+    T *x, *y, *z;
+};
+
+namespace detail {
+
+/* Vertices per parallel chunk */
+constexpr std::size_t skin_grain = 4096;
+
+/* Offsets of the 3x4 affine part inside of a column-major matrix4, column by column. */
+constexpr std::size_t skin_affine[12] = {0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14};
+
+template <typename T>
+inline void skin_store_normal(const T &x, const T &y, const T &z, const skin_output<T> &out, const std::size_t &i) {
+    const T length = std::sqrt(x*x + y*y + z*z);
+    const T inv = length > T(0) ? T(1) / length : T(0);
+    out.x[i] = x * inv;
+    out.y[i] = y * inv;
+    out.z[i] = z * inv;
+}
+
+#if defined(MTP_AVX2)
+inline __m256 skin_fmadd(const __m256 &a, const __m256 &b, const __m256 &c) {
+#if defined(MTP_FMA)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+/* 1/length, 0 for zero length */
+inline __m256 skin_inv_length(const __m256 &squared) {
+    const __m256 length = _mm256_sqrt_ps(squared);
+    const __m256 inv = _mm256_div_ps(_mm256_set1_ps(1.0f), length);
+    return _mm256_and_ps(inv, _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ));
+}
+
+inline void skin_store_normal8(const __m256 &x, const __m256 &y, const __m256 &z, const skin_output<float> &out, const std::size_t &i) {
+    const __m256 inv = skin_inv_length(skin_fmadd(x, x, skin_fmadd(y, y, _mm256_mul_ps(z, z))));
+    _mm256_storeu_ps(out.x + i, _mm256_mul_ps(x, inv));
+    _mm256_storeu_ps(out.y + i, _mm256_mul_ps(y, inv));
+    _mm256_storeu_ps(out.z + i, _mm256_mul_ps(z, inv));
+}
+
+/* Gathers the lanes set in mask, zero elsewhere: zero-weight slots never touch the palette. */
+inline __m256 skin_gather8(const float* base, const __m256i &idx, const __m256 &mask) {
+    return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, idx, mask, 4);
+}
+
+/* Joint indices of 8 vertices scaled to the first float of their palette entries. */
+template <std::size_t Shift>
+inline __m256i skin_joints8(const std::uint16_t* joints) {
+    const __m128i j = _mm_loadu_si128(reinterpret_cast<const __m128i*>(joints));
+    return _mm256_slli_epi32(_mm256_cvtepu16_epi32(j), Shift);
+}
+#endif
+
+/* Linear blend skinning of vertices [i, end). */
+template <typename T, std::size_t K, bool Normals>
+void skin_linear_span(const matrix<T, 4, 4>* palette, const skin_influences<T, K> &inf, const vertex_soa<T> &positions,
+    const vertex_soa<T> &normals, const skin_output<T> &out, const skin_output<T> &out_normals, std::size_t i, const std::size_t &end)
+{
+#if defined(MTP_AVX2)
+    if constexpr(std::is_same_v<T, float>) {
+        static_assert(sizeof(matrix<float, 4, 4>) == 16*sizeof(float), "Bone palettes must be tightly packed.");
+        const float* base = palette[0].data;
+        for(; i + 8 <= end; i += 8) {
+            __m256 m[12];
+            for(std::size_t e = 0; e < 12; e++) m[e] = _mm256_setzero_ps();
+            for(std::size_t k = 0; k < K; k++) {
+                const __m256 w = _mm256_loadu_ps(inf.weights[k] + i);
+                const __m256 used = _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+                if(!_mm256_movemask_ps(used)) continue; /* unused slot */
+                const __m256i idx = skin_joints8<4>(inf.joints[k] + i);
+                for(std::size_t e = 0; e < 12; e++) m[e] = skin_fmadd(w, skin_gather8(base + skin_affine[e], idx, used), m[e]);
+            }
+
+            const __m256 x = _mm256_loadu_ps(positions.x + i), y = _mm256_loadu_ps(positions.y + i), z = _mm256_loadu_ps(positions.z + i);
+            _mm256_storeu_ps(out.x + i, skin_fmadd(m[0], x, skin_fmadd(m[3], y, skin_fmadd(m[6], z, m[9]))));
+            _mm256_storeu_ps(out.y + i, skin_fmadd(m[1], x, skin_fmadd(m[4], y, skin_fmadd(m[7], z, m[10]))));
+            _mm256_storeu_ps(out.z + i, skin_fmadd(m[2], x, skin_fmadd(m[5], y, skin_fmadd(m[8], z, m[11]))));
+            if constexpr(Normals) {
+                const __m256 nx = _mm256_loadu_ps(normals.x + i), ny = _mm256_loadu_ps(normals.y + i), nz = _mm256_loadu_ps(normals.z + i);
+                skin_store_normal8(
+                    skin_fmadd(m[0], nx, skin_fmadd(m[3], ny, _mm256_mul_ps(m[6], nz))),
+                    skin_fmadd(m[1], nx, skin_fmadd(m[4], ny, _mm256_mul_ps(m[7], nz))),
+                    skin_fmadd(m[2], nx, skin_fmadd(m[5], ny, _mm256_mul_ps(m[8], nz))), out_normals, i);
+            }
+        }
+    }
+#endif
+    for(; i < end; i++) {
+        T m[12] = {};
+        for(std::size_t k = 0; k < K; k++) {
+            const T w = inf.weights[k][i];
+            if(w == T(0)) continue;
+            const T* b = palette[inf.joints[k][i]].data;
+            for(std::size_t e = 0; e < 12; e++) m[e] += w * b[skin_affine[e]];
+        }
+        const T x = positions.x[i], y = positions.y[i], z = positions.z[i];
+        out.x[i] = m[0]*x + m[3]*y + m[6]*z + m[9];
+        out.y[i] = m[1]*x + m[4]*y + m[7]*z + m[10];
+        out.z[i] = m[2]*x + m[5]*y + m[8]*z + m[11];
+        if constexpr(Normals) {
+            const T nx = normals.x[i], ny = normals.y[i], nz = normals.z[i];
+            skin_store_normal(m[0]*nx + m[3]*ny + m[6]*nz, m[1]*nx + m[4]*ny + m[7]*nz, m[2]*nx + m[5]*ny + m[8]*nz, out_normals, i);
+        }
+    }
+}
+
+/*
+* Dual quaternion skinning of vertices [i, end): influences are flipped into the hemisphere of the
+* first one with a nonzero weight, blended and divided by the length of the real part. p' = p + 2*r.xyz x (r.xyz x p + r.w*p) + t
+* with t = 2*(r.w*d.xyz - d.w*r.xyz + r.xyz x d.xyz).
+*/
+template <std::size_t K, bool Normals>
+void skin_dual_quat_span(const dual_quat* palette, const skin_influences<float, K> &inf, const vertex_soa<float> &positions,
+    const vertex_soa<float> &normals, const skin_output<float> &out, const skin_output<float> &out_normals, std::size_t i, const std::size_t &end)
+{
+#if defined(MTP_AVX2)
+    static_assert(sizeof(dual_quat) == 8*sizeof(float), "Dual quaternion palettes must be tightly packed.");
+    const float* base = &palette[0].real.x;
+    for(; i + 8 <= end; i += 8) {
+        __m256 q[8], first[4], found = _mm256_setzero_ps();
+        for(std::size_t e = 0; e < 8; e++) q[e] = _mm256_setzero_ps();
+        for(std::size_t e = 0; e < 4; e++) first[e] = _mm256_setzero_ps();
+        for(std::size_t k = 0; k < K; k++) {
+            __m256 w = _mm256_loadu_ps(inf.weights[k] + i);
+            const __m256 used = _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+            if(!_mm256_movemask_ps(used)) continue;
+            const __m256i idx = skin_joints8<3>(inf.joints[k] + i);
+            __m256 d[8];
+            for(std::size_t e = 0; e < 8; e++) d[e] = skin_gather8(base + e, idx, used);
+
+            /* the first used influence of every lane is the reference rotation */
+            const __m256 take = _mm256_andnot_ps(found, used);
+            for(std::size_t e = 0; e < 4; e++) first[e] = _mm256_blendv_ps(first[e], d[e], take);
+            found = _mm256_or_ps(found, used);
+
+            /* shortest path: negate the weight where the rotation points away from the first influence */
+            const __m256 dot = skin_fmadd(d[0], first[0], skin_fmadd(d[1], first[1], skin_fmadd(d[2], first[2], _mm256_mul_ps(d[3], first[3]))));
+            w = _mm256_xor_ps(w, _mm256_and_ps(_mm256_cmp_ps(dot, _mm256_setzero_ps(), _CMP_LT_OQ), _mm256_set1_ps(-0.0f)));
+            for(std::size_t e = 0; e < 8; e++) q[e] = skin_fmadd(w, d[e], q[e]);
+        }
+
+        const __m256 inv = skin_inv_length(skin_fmadd(q[0], q[0], skin_fmadd(q[1], q[1], skin_fmadd(q[2], q[2], _mm256_mul_ps(q[3], q[3])))));
+        for(std::size_t e = 0; e < 8; e++) q[e] = _mm256_mul_ps(q[e], inv);
+        const __m256 &rx = q[0], &ry = q[1], &rz = q[2], &rw = q[3];
+        const __m256 &dx = q[4], &dy = q[5], &dz = q[6], &dw = q[7];
+
+        /* v + 2 * r x (r x v + w*v) */
+        auto rotate = [&](const __m256 &x, const __m256 &y, const __m256 &z, __m256 &ox, __m256 &oy, __m256 &oz) {
+            const __m256 cx = skin_fmadd(rw, x, _mm256_sub_ps(_mm256_mul_ps(ry, z), _mm256_mul_ps(rz, y)));
+            const __m256 cy = skin_fmadd(rw, y, _mm256_sub_ps(_mm256_mul_ps(rz, x), _mm256_mul_ps(rx, z)));
+            const __m256 cz = skin_fmadd(rw, z, _mm256_sub_ps(_mm256_mul_ps(rx, y), _mm256_mul_ps(ry, x)));
+            const __m256 two = _mm256_set1_ps(2.0f);
+            ox = skin_fmadd(two, _mm256_sub_ps(_mm256_mul_ps(ry, cz), _mm256_mul_ps(rz, cy)), x);
+            oy = skin_fmadd(two, _mm256_sub_ps(_mm256_mul_ps(rz, cx), _mm256_mul_ps(rx, cz)), y);
+            oz = skin_fmadd(two, _mm256_sub_ps(_mm256_mul_ps(rx, cy), _mm256_mul_ps(ry, cx)), z);
+        };
+
+        const __m256 tx = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(rw, dx), _mm256_mul_ps(dw, rx)), _mm256_sub_ps(_mm256_mul_ps(ry, dz), _mm256_mul_ps(rz, dy)));
+        const __m256 ty = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(rw, dy), _mm256_mul_ps(dw, ry)), _mm256_sub_ps(_mm256_mul_ps(rz, dx), _mm256_mul_ps(rx, dz)));
+        const __m256 tz = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(rw, dz), _mm256_mul_ps(dw, rz)), _mm256_sub_ps(_mm256_mul_ps(rx, dy), _mm256_mul_ps(ry, dx)));
+
+        __m256 px, py, pz;
+        rotate(_mm256_loadu_ps(positions.x + i), _mm256_loadu_ps(positions.y + i), _mm256_loadu_ps(positions.z + i), px, py, pz);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        _mm256_storeu_ps(out.x + i, skin_fmadd(two, tx, px));
+        _mm256_storeu_ps(out.y + i, skin_fmadd(two, ty, py));
+        _mm256_storeu_ps(out.z + i, skin_fmadd(two, tz, pz));
+        if constexpr(Normals) {
+            __m256 nx, ny, nz;
+            rotate(_mm256_loadu_ps(normals.x + i), _mm256_loadu_ps(normals.y + i), _mm256_loadu_ps(normals.z + i), nx, ny, nz);
+            _mm256_storeu_ps(out_normals.x + i, nx);
+            _mm256_storeu_ps(out_normals.y + i, ny);
+            _mm256_storeu_ps(out_normals.z + i, nz);
+        }
+    }
+#endif
+    for(; i < end; i++) {
+        float q[8] = {};
+        const quat* first = nullptr;
+        for(std::size_t k = 0; k < K; k++) {
+            float w = inf.weights[k][i];
+            if(w == 0.0f) continue;
+            const dual_quat &b = palette[inf.joints[k][i]];
+            if(!first) first = &b.real;
+            if(b.real.x*first->x + b.real.y*first->y + b.real.z*first->z + b.real.w*first->w < 0.0f) w = -w;
+            const float d[8] = {b.real.x, b.real.y, b.real.z, b.real.w, b.dual.x, b.dual.y, b.dual.z, b.dual.w};
+            for(std::size_t e = 0; e < 8; e++) q[e] += w * d[e];
+        }
+
+        const float length = std::sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+        const float inv = length > 0.0f ? 1.0f / length : 0.0f;
+        for(std::size_t e = 0; e < 8; e++) q[e] *= inv;
+        const float rx = q[0], ry = q[1], rz = q[2], rw = q[3], dx = q[4], dy = q[5], dz = q[6], dw = q[7];
+
+        auto rotate = [&](const float &x, const float &y, const float &z, float &ox, float &oy, float &oz) {
+            const float cx = rw*x + ry*z - rz*y, cy = rw*y + rz*x - rx*z, cz = rw*z + rx*y - ry*x;
+            ox = x + 2.0f*(ry*cz - rz*cy);
+            oy = y + 2.0f*(rz*cx - rx*cz);
+            oz = z + 2.0f*(rx*cy - ry*cx);
+        };
+
+        float px, py, pz;
+        rotate(positions.x[i], positions.y[i], positions.z[i], px, py, pz);
+        out.x[i] = px + 2.0f*(rw*dx - dw*rx + ry*dz - rz*dy);
+        out.y[i] = py + 2.0f*(rw*dy - dw*ry + rz*dx - rx*dz);
+        out.z[i] = pz + 2.0f*(rw*dz - dw*rz + rx*dy - ry*dx);
+        if constexpr(Normals) rotate(normals.x[i], normals.y[i], normals.z[i], out_normals.x[i], out_normals.y[i], out_normals.z[i]);
+    }
+}
+
+}
+
+/**
+* @brief Linear blend skinning: every position goes through the weighted sum of its bone matrices.
+* @param palette bone matrices (bind pose inverse already applied), indexed by the joint streams
+* @param influences K joint and weight streams, positions.count entries each
+* @param parallel splits the vertices between hardware threads
+*/
+template <typename T, std::size_t K>
+void skin_linear(const matrix<T, 4, 4>* palette, const skin_influences<T, K> &influences, const vertex_soa<T> &positions,
+    const skin_output<T> &out, const bool &parallel = true)
+{
+    MTP_PROFILE_OP(matmul, positions.count, positions.count*(24*K + 18));
+    parallel_for_chunks(plan_chunks(positions.count, detail::skin_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        detail::skin_linear_span<T, K, false>(palette, influences, positions, positions, out, out, begin, end);
+    });
+}
+
+/**
+* @brief Linear blend skinning of positions and normals.
+* @param normals count must match positions.count
+*/
+template <typename T, std::size_t K>
+void skin_linear(const matrix<T, 4, 4>* palette, const skin_influences<T, K> &influences, const vertex_soa<T> &positions,
+    const vertex_soa<T> &normals, const skin_output<T> &out, const skin_output<T> &out_normals, const bool &parallel = true)
+{
+    MTP_PROFILE_OP(matmul, positions.count, positions.count*(24*K + 44));
+    parallel_for_chunks(plan_chunks(positions.count, detail::skin_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        detail::skin_linear_span<T, K, true>(palette, influences, positions, normals, out, out_normals, begin, end);
+    });
+}
+
+/**
+* @brief Dual quaternion skinning: blends rigid transforms without the volume loss of linear blending
+* at twisted joints. Bones must be rigid (see to_dual_quat()).
+* @param palette unit dual quaternions, indexed by the joint streams
+* @param parallel splits the vertices between hardware threads
+*/
+template <std::size_t K>
+void skin_dual_quat(const dual_quat* palette, const skin_influences<float, K> &influences, const vertex_soa<float> &positions,
+    const skin_output<float> &out, const bool &parallel = true)
+{
+    MTP_PROFILE_OP(matmul, positions.count, positions.count*(20*K + 60));
+    parallel_for_chunks(plan_chunks(positions.count, detail::skin_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        detail::skin_dual_quat_span<K, false>(palette, influences, positions, positions, out, out, begin, end);
+    });
+}
+
+/**
+* @brief Dual quaternion skinning of positions and normals.
+* @param normals count must match positions.count
+*/
+template <std::size_t K>
+void skin_dual_quat(const dual_quat* palette, const skin_influences<float, K> &influences, const vertex_soa<float> &positions,
+    const vertex_soa<float> &normals, const skin_output<float> &out, const skin_output<float> &out_normals, const bool &parallel = true)
+{
+    MTP_PROFILE_OP(matmul, positions.count, positions.count*(20*K + 84));
+    parallel_for_chunks(plan_chunks(positions.count, detail::skin_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        detail::skin_dual_quat_span<K, true>(palette, influences, positions, normals, out, out_normals, begin, end);
+    });
+}
+
+}
+
+#endif
@@ -0,0 +1,289 @@
+#ifndef SPARSE_HPP
+#define SPARSE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+
+namespace mtp {
+
+/**
+* @brief Block-sparse 3d matrix. Space is split into bricks of B*B*B elements (B = 2^BrickLog2),
+* a brick is allocated on the first write into it, every other element reads as the background value.
+*
+* Coordinates and the layout inside of a brick follow dynamic_matrix3d: layers along y, rows along z.
+* A hash table maps brick coordinates to brick slots, brick memory stays stable while bricks are added.
+*
+* @arg T - element type.
+* @arg BrickLog2 - log2 of the brick edge (3 -> 8x8x8 bricks).
+*/
+template <typename T, std::size_t BrickLog2 = 3>
+struct sparse_matrix3d {
+    static_assert(BrickLog2 > 0 && BrickLog2 < 8, "Brick edge must be within 2..128.");
+
+    static constexpr std::size_t B = std::size_t(1) << BrickLog2; /* brick edge */
+    static constexpr std::size_t BB = B*B;
+    static constexpr std::size_t BBB = B*B*B; /* elements in one brick */
+    static constexpr std::size_t MASK = B - 1;
+
+    /* Active brick: brick coordinates (element coordinates >> BrickLog2) and its elements. */
+    struct brick {
+        std::size_t bx, by, bz;
+        std::unique_ptr<T[]> data;
+    };
+
+    std::size_t w = 0;
+    std::size_t h = 0;
+    std::size_t v = 0;
+    T background = T();
+
+    sparse_matrix3d()
+    {
+
+    }
+
+    sparse_matrix3d(const std::size_t &width, const std::size_t &height, const std::size_t &volume, const T& background = T()) :
+        w(width), h(height), v(volume), background(background)
+    {
+
+    }
+
+    /* Offset of a local coordinate inside of a brick */
+    static constexpr inline std::size_t local(const std::size_t &x, const std::size_t &y, const std::size_t &z) {
+        return (y & MASK)*BB + (z & MASK)*B + (x & MASK);
+    }
+
+    /**
+    * @brief Reads an element, bricks are never allocated.
+    * @param x Width
+    * @param y Height
+    * @param z Volume
+    */
+    inline const T& get(const std::size_t &x, const std::size_t &y, const std::size_t &z) const {
+        const T* b = find(x >> BrickLog2, y >> BrickLog2, z >> BrickLog2);
+        return b ? b[local(x, y, z)] : background;
+    }
+
+    /**
+    * @brief Writable reference to an element, allocates its brick (filled with background) if needed.
+    */
+    inline T& at(const std::size_t &x, const std::size_t &y, const std::size_t &z) {
+        return touch(x >> BrickLog2, y >> BrickLog2, z >> BrickLog2)[local(x, y, z)];
+    }
+
+    /**
+    * @brief Writes an element. Writing the background into an empty brick allocates nothing.
+    */
+    inline void set(const std::size_t &x, const std::size_t &y, const std::size_t &z, const T& value) {
+        T* b = find(x >> BrickLog2, y >> BrickLog2, z >> BrickLog2);
+        if(!b) {
+            if(value == background) return;
+            b = touch(x >> BrickLog2, y >> BrickLog2, z >> BrickLog2);
+        }
+        b[local(x, y, z)] = value;
+    }
+
+    /* Elements of the brick with brick coordinates bxyz, nullptr if it is not allocated. */
+    inline T* find(const std::size_t &bx, const std::size_t &by, const std::size_t &bz) {
+        const auto it = table.find(key(bx, by, bz));
+        return it == table.end() ? nullptr : bricks[it->second].data.get();
+    }
+
+    inline const T* find(const std::size_t &bx, const std::size_t &by, const std::size_t &bz) const {
+        const auto it = table.find(key(bx, by, bz));
+        return it == table.end() ? nullptr : bricks[it->second].data.get();
+    }
+
+    /* Elements of the brick with brick coordinates bxyz, allocated on demand. */
+    T* touch(const std::size_t &bx, const std::size_t &by, const std::size_t &bz) {
+        const auto inserted = table.emplace(key(bx, by, bz), static_cast<std::uint32_t>(bricks.size()));
+        if(!inserted.second) return bricks[inserted.first->second].data.get();
+
+        MTP_PROFILE_OP(allocation, BBB, 0);
+        brick b{bx, by, bz, std::unique_ptr<T[]>(new T[BBB])};
+        std::fill(b.data.get(), b.data.get() + BBB, background);
+        bricks.push_back(std::move(b));
+        return bricks.back().data.get();
+    }
+
+    inline std::size_t brick_count() const { return bricks.size(); }
+
+    /* Memory of the allocated bricks in bytes */
+    inline std::size_t brick_bytes() const { return bricks.size() * BBB * sizeof(T); }
+
+    inline const std::vector<brick>& active_bricks() const { return bricks; }
+
+    /**
+    * @brief Calls fn(bx, by, bz, data) for every allocated brick.
+    */
+    template <typename Fn>
+    void for_each_brick(Fn&& fn) {
+        for(brick &b : bricks) fn(b.bx, b.by, b.bz, b.data.get());
+    }
+
+    template <typename Fn>
+    void for_each_brick(Fn&& fn) const {
+        for(const brick &b : bricks) fn(b.bx, b.by, b.bz, static_cast<const T*>(b.data.get()));
+    }
+
+    /**
+    * @brief for_each_brick() split between hardware threads. fn must only touch the brick it gets.
+    */
+    template <typename Fn>
+    void parallel_for_each_brick(Fn&& fn) {
+        parallel_for(bricks.size(), brick_grain, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; i++) fn(bricks[i].bx, bricks[i].by, bricks[i].bz, bricks[i].data.get());
+        });
+    }
+
+    /**
+    * @brief Frees bricks that only contain the background value.
+    * @return Number of freed bricks.
+    */
+    std::size_t prune() {
+        std::vector<std::uint8_t> empty(bricks.size());
+        parallel_for(bricks.size(), brick_grain, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; i++) empty[i] = only_background(bricks[i].data.get());
+        });
+
+        std::size_t kept = 0;
+        for(std::size_t i = 0; i < bricks.size(); i++) {
+            if(empty[i]) continue;
+            if(kept != i) bricks[kept] = std::move(bricks[i]);
+            kept++;
+        }
+        const std::size_t freed = bricks.size() - kept;
+        bricks.resize(kept);
+        rebuild_table();
+        return freed;
+    }
+
+    void clear() {
+        bricks.clear();
+        table.clear();
+    }
+
+    /**
+    * @brief Builds a sparse matrix from a dense one, bricks that only contain the background are skipped.
+    */
+    template <std::size_t Inline>
+    static sparse_matrix3d from_dense(const dynamic_matrix3d<T, Inline> &dense, const T& background = T()) {
+        sparse_matrix3d result(dense.w, dense.h, dense.v, background);
+        const std::size_t nx = (dense.w + MASK) >> BrickLog2;
+        const std::size_t ny = (dense.h + MASK) >> BrickLog2;
+        const std::size_t nz = (dense.v + MASK) >> BrickLog2;
+
+        /* every chunk of brick rows gathers its bricks locally, the table is filled afterwards */
+        const chunk_plan plan = plan_chunks(ny*nz, 1);
+        std::vector<std::vector<brick>> found(plan.chunks);
+        parallel_for_chunks(plan, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            std::unique_ptr<T[]> scratch;
+            for(std::size_t row = begin; row < end; row++) {
+                const std::size_t by = row / nz, bz = row % nz;
+                for(std::size_t bx = 0; bx < nx; bx++) {
+                    if(!scratch) scratch.reset(new T[BBB]);
+                    if(result.gather(dense, bx, by, bz, scratch.get())) {
+                        found[chunk].push_back(brick{bx, by, bz, std::move(scratch)});
+                    }
+                }
+            }
+        });
+
+        for(std::vector<brick> &list : found) {
+            for(brick &b : list) result.bricks.push_back(std::move(b));
+        }
+        result.rebuild_table();
+        return result;
+    }
+
+    /**
+    * @brief Writes every element into a dense matrix of the same size.
+    */
+    template <std::size_t Inline>
+    void to_dense(dynamic_matrix3d<T, Inline> &dense) const {
+        if(dense.w != w || dense.h != h || dense.v != v || dense.is_shared()) dense.resize(w, h, v);
+
+        parallel_for(h, 1, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t y = begin; y < end; y++) {
+                std::fill(dense.data + dense.index(0, y, 0), dense.data + dense.index(0, y, 0) + w*v, background);
+            }
+        });
+        parallel_for(bricks.size(), brick_grain, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; i++) scatter(dense, bricks[i]);
+        });
+    }
+
+private:
+    std::vector<brick> bricks;
+    std::unordered_map<std::uint64_t, std::uint32_t> table;
+
+    /* Bricks per parallel chunk */
+    static constexpr std::size_t brick_grain = 64;
+
+    /* 21 bits per axis */
+    static constexpr inline std::uint64_t key(const std::size_t &bx, const std::size_t &by, const std::size_t &bz) {
+        return (static_cast<std::uint64_t>(by) << 42) | (static_cast<std::uint64_t>(bz) << 21) | static_cast<std::uint64_t>(bx);
+    }
+
+    void rebuild_table() {
+        table.clear();
+        table.reserve(bricks.size());
+        for(std::size_t i = 0; i < bricks.size(); i++) {
+            table.emplace(key(bricks[i].bx, bricks[i].by, bricks[i].bz), static_cast<std::uint32_t>(i));
+        }
+    }
+
+    inline bool only_background(const T* data) const {
+        for(std::size_t i = 0; i < BBB; i++) {
+            if(!(data[i] == background)) return false;
+        }
+        return true;
+    }
+
+    /* Copies a brick out of a dense matrix (background outside of it), false if it holds only background. */
+    template <std::size_t Inline>
+    bool gather(const dynamic_matrix3d<T, Inline> &dense, const std::size_t &bx, const std::size_t &by, const std::size_t &bz, T* out) const {
+        const std::size_t x0 = bx << BrickLog2, y0 = by << BrickLog2, z0 = bz << BrickLog2;
+        const std::size_t nx = std::min(B, dense.w - x0);
+        const std::size_t ny = std::min(B, dense.h - y0);
+        const std::size_t nz = std::min(B, dense.v - z0);
+
+        bool active = false;
+        if(nx < B || ny < B || nz < B) std::fill(out, out + BBB, background);
+        for(std::size_t ly = 0; ly < ny; ly++) {
+            for(std::size_t lz = 0; lz < nz; lz++) {
+                const T* src = dense.data + dense.index(x0, y0 + ly, z0 + lz);
+                T* dst = out + ly*BB + lz*B;
+                for(std::size_t lx = 0; lx < nx; lx++) {
+                    dst[lx] = src[lx];
+                    active |= !(src[lx] == background);
+                }
+            }
+        }
+        return active;
+    }
+
+    template <std::size_t Inline>
+    void scatter(dynamic_matrix3d<T, Inline> &dense, const brick &b) const {
+        const std::size_t x0 = b.bx << BrickLog2, y0 = b.by << BrickLog2, z0 = b.bz << BrickLog2;
+        if(x0 >= w || y0 >= h || z0 >= v) return;
+        const std::size_t nx = std::min(B, w - x0);
+        const std::size_t ny = std::min(B, h - y0);
+        const std::size_t nz = std::min(B, v - z0);
+
+        for(std::size_t ly = 0; ly < ny; ly++) {
+            for(std::size_t lz = 0; lz < nz; lz++) {
+                const T* src = b.data.get() + ly*BB + lz*B;
+                std::copy(src, src + nx, dense.data + dense.index(x0, y0 + ly, z0 + lz));
+            }
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef SPLINE_HPP
+#define SPLINE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "vector.hpp"
+#include "parallel.hpp"
+
+namespace mtp {
+
+/* Cubic bases of spline segments. */
+enum class spline_basis {
+    catmull_rom, /* passes through every point, segment i runs from points[i] to points[i+1] */
+    b_spline,    /* uniform cubic B-spline, C2 smooth, approximates the points */
+    bezier       /* piecewise cubic Bezier, points[3i] .. points[3i+3] form segment i */
+};
+
+namespace detail {
+
+/* Power basis coefficients: c[k] = sum m[k][j] * p[j], P(t) = c0 + c1*t + c2*t^2 + c3*t^3. */
+template <typename T>
+struct spline_matrix {
+    T m[4][4];
+};
+
+template <typename T>
+constexpr spline_matrix<T> basis_matrix(const spline_basis &basis) {
+    switch(basis) {
+        case spline_basis::b_spline: return {{
+            { T(1)/6,  T(4)/6, T(1)/6, T(0)},
+            {-T(3)/6,  T(0),   T(3)/6, T(0)},
+            { T(3)/6, -T(6)/6, T(3)/6, T(0)},
+            {-T(1)/6,  T(3)/6,-T(3)/6, T(1)/6}}};
+        case spline_basis::bezier: return {{
+            { T(1),  T(0),  T(0), T(0)},
+            {-T(3),  T(3),  T(0), T(0)},
+            { T(3), -T(6),  T(3), T(0)},
+            {-T(1),  T(3), -T(3), T(1)}}};
+        default: return {{
+            { T(0),    T(1),    T(0),    T(0)},
+            {-T(0.5),  T(0),    T(0.5),  T(0)},
+            { T(1),   -T(2.5),  T(2),   -T(0.5)},
+            {-T(0.5),  T(1.5), -T(1.5),  T(0.5)}}};
+    }
+}
+
+/* Objects per parallel chunk */
+constexpr std::size_t spline_grain = 2048;
+
+}
+
+/**
+* @brief Multi-segment cubic spline over runtime control points with an arc-length table.
+* The parameter u runs over [0, segments()), the integer part selects the segment.
+* Call build() after changing the points.
+* @arg T - float or double.
+* @arg N - Space dimension.
+*/
+template <typename T, std::size_t N>
+struct spline {
+    using point_type = vector<T, N>;
+
+    spline_basis basis = spline_basis::catmull_rom;
+    bool closed = false;
+    std::vector<point_type> points;
+
+    spline()
+    {
+
+    }
+
+    /**
+    * @param closed the path loops back to the first point
+    * @param lut_size entries of the arc-length table, 0 - 32 per segment
+    */
+    spline(const spline_basis &basis, std::vector<point_type> points, const bool &closed = false, const std::size_t &lut_size = 0) :
+        basis(basis), closed(closed), points(std::move(points))
+    {
+        build(lut_size);
+    }
+
+    std::size_t segments() const {
+        const std::size_t n = points.size();
+        switch(basis) {
+            case spline_basis::catmull_rom: return closed ? (n > 2 ? n : 0) : (n > 1 ? n - 1 : 0);
+            case spline_basis::b_spline:    return closed ? (n > 3 ? n : 0) : (n > 3 ? n - 3 : 0);
+            default:                        return closed ? n / 3 : (n > 3 ? (n - 1) / 3 : 0);
+        }
+    }
+
+    /**
+    * @brief Converts the points into per-segment polynomials and rebuilds the arc-length table.
+    * @param lut_size entries of the table, 0 - 32 per segment
+    * @param subdivisions length integration steps per segment (3-point Gauss-Legendre each)
+    */
+    void build(std::size_t lut_size = 0, const std::size_t &subdivisions = 32) {
+        const std::size_t count = segments();
+        const detail::spline_matrix<T> m = detail::basis_matrix<T>(basis);
+        coeffs.assign(count*4*N, T(0));
+
+        for(std::size_t s = 0; s < count; s++) {
+            const point_type* p[4];
+            for(std::size_t j = 0; j < 4; j++) p[j] = &points[control(s, j)];
+            for(std::size_t k = 0; k < 4; k++) {
+                for(std::size_t d = 0; d < N; d++) {
+                    coeffs[(s*4+k)*N+d] = m.m[k][0]*p[0]->data[d] + m.m[k][1]*p[1]->data[d] + m.m[k][2]*p[2]->data[d] + m.m[k][3]*p[3]->data[d];
+                }
+            }
+        }
+        build_lut(lut_size ? lut_size : count*32 + 1, subdivisions ? subdivisions : 1);
+    }
+
+    /* Position at parameter u, clamped (open) or wrapped (closed) to [0, segments()]. */
+    point_type evaluate(const T &u) const {
+        point_type result;
+        T t;
+        const T* c = segment(u, t);
+        if(!c) return points.empty() ? result : points.front();
+        for(std::size_t d = 0; d < N; d++) result.data[d] = ((c[3*N+d]*t + c[2*N+d])*t + c[N+d])*t + c[d];
+        return result;
+    }
+
+    /* dP/du at parameter u. */
+    point_type derivative(const T &u) const {
+        point_type result;
+        T t;
+        const T* c = segment(u, t);
+        if(!c) return result;
+        for(std::size_t d = 0; d < N; d++) result.data[d] = (T(3)*c[3*N+d]*t + T(2)*c[2*N+d])*t + c[N+d];
+        return result;
+    }
+
+    inline T length() const { return total; }
+
+    /**
+    * @brief Parameter u that lies distance along the path, O(1) through the arc-length table.
+    * Distances are clamped to [0, length()] for open paths and wrapped for closed ones.
+    */
+    T parameter_at(T distance) const {
+        if(lut.size() < 2 || total <= T(0)) return T(0);
+        if(closed) {
+            distance = std::fmod(distance, total);
+            if(distance < T(0)) distance += total;
+        }
+        const T x = std::clamp(distance * lut_scale, T(0), static_cast<T>(lut.size() - 1));
+        const std::size_t i = std::min(static_cast<std::size_t>(x), lut.size() - 2);
+        const T f = x - static_cast<T>(i), f2 = f*f, f3 = f2*f;
+
+        /* cubic Hermite through the entries with du/ds = 1/speed, exact for piecewise constant speed */
+        return lut[i]*(T(2)*f3 - T(3)*f2 + T(1)) + slope[i]*(f3 - T(2)*f2 + f) + lut[i+1]*(T(3)*f2 - T(2)*f3) + slope[i+1]*(f3 - f2);
+    }
+
+    /* Position at distance along the path, constant speed for evenly spaced distances. */
+    inline point_type at_distance(const T &distance) const {
+        return evaluate(parameter_at(distance));
+    }
+
+private:
+    std::vector<T> coeffs;  /* segments x 4 powers x N */
+    std::vector<T> lut;     /* parameter at evenly spaced distances */
+    std::vector<T> slope;   /* du/ds at the entries times the entry spacing */
+    T total = T(0);
+    T lut_scale = T(0);     /* (lut.size() - 1) / total */
+
+    std::size_t control(const std::size_t &s, const std::size_t &j) const {
+        const std::size_t n = points.size();
+        switch(basis) {
+            case spline_basis::catmull_rom: {
+                const std::ptrdiff_t i = static_cast<std::ptrdiff_t>(s + j) - 1;
+                if(closed) return static_cast<std::size_t>((i + static_cast<std::ptrdiff_t>(n)) % static_cast<std::ptrdiff_t>(n));
+                return static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(i, 0, static_cast<std::ptrdiff_t>(n) - 1));
+            }
+            case spline_basis::b_spline: return (s + j) % n;
+            default:                     return (3*s + j) % n;
+        }
+    }
+
+    /* Coefficients of the segment holding u and the local parameter t. */
+    const T* segment(T u, T &t) const {
+        const std::size_t count = coeffs.size() / (4*N);
+        if(count == 0) return nullptr;
+        const T end = static_cast<T>(count);
+        if(closed) {
+            u = std::fmod(u, end);
+            if(u < T(0)) u += end;
+        } else {
+            u = std::clamp(u, T(0), end);
+        }
+        const std::size_t s = std::min(static_cast<std::size_t>(u), count - 1);
+        t = u - static_cast<T>(s);
+        return coeffs.data() + s*4*N;
+    }
+
+    T speed(const T &u) const {
+        const point_type d = derivative(u);
+        T sum = T(0);
+        for(std::size_t i = 0; i < N; i++) sum += d.data[i]*d.data[i];
+        return std::sqrt(sum);
+    }
+
+    void build_lut(const std::size_t &lut_size, const std::size_t &subdivisions) {
+        const std::size_t count = coeffs.size() / (4*N);
+        lut.clear();
+        slope.clear();
+        total = T(0);
+        lut_scale = T(0);
+        if(count == 0) return;
+
+        /* cumulative length at u = i / subdivisions */
+        const std::size_t steps = count*subdivisions;
+        const T h = T(1) / static_cast<T>(subdivisions);
+        const T g = std::sqrt(T(0.6)) * T(0.5);
+        std::vector<T> cumulative(steps + 1, T(0));
+        for(std::size_t i = 0; i < steps; i++) {
+            const T mid = (static_cast<T>(i) + T(0.5)) * h;
+            const T piece = h * (T(5)*speed(mid - g*h) + T(8)*speed(mid) + T(5)*speed(mid + g*h)) / T(18);
+            cumulative[i+1] = cumulative[i] + piece;
+        }
+        total = cumulative.back();
+
+        /* invert: parameter at evenly spaced distances */
+        lut.resize(std::max<std::size_t>(lut_size, 2));
+        slope.resize(lut.size());
+        const T spacing = total / static_cast<T>(lut.size() - 1);
+        std::size_t j = 0;
+        for(std::size_t i = 0; i < lut.size(); i++) {
+            const T d = total * static_cast<T>(i) / static_cast<T>(lut.size() - 1);
+            while(j + 1 < steps && cumulative[j+1] < d) j++;
+            const T span = cumulative[j+1] - cumulative[j];
+            const T f = span > T(0) ? std::clamp((d - cumulative[j]) / span, T(0), T(1)) : T(0);
+            const T u0 = static_cast<T>(j) * h;
+
+            /* Newton steps on the length measured from the integration step start */
+            T u = u0 + f*h;
+            for(std::size_t it = 0; it < 2; it++) {
+                const T v = speed(u);
+                if(v <= T(0)) break;
+                const T half = (u - u0) * T(0.5), mid = u0 + half;
+                const T measured = cumulative[j] + half * (T(5)*speed(mid - T(2)*g*half) + T(8)*speed(mid) + T(5)*speed(mid + T(2)*g*half)) / T(9);
+                u = std::clamp(u - (measured - d) / v, u0, u0 + h);
+            }
+            lut[i] = u;
+            const T v = speed(lut[i]);
+            slope[i] = v > T(0) ? spacing / v : (lut[i] - (i ? lut[i-1] : lut[i]));
+        }
+        lut_scale = total > T(0) ? static_cast<T>(lut.size() - 1) / total : T(0);
+    }
+};
+
+/**
+* @brief Positions of many objects along many paths.
+* @param path index of the path of every object
+* @param distance distance travelled by every object along its path
+* @param parallel splits the objects between hardware threads
+*/
+template <typename T, std::size_t N>
+void sample_paths(const spline<T, N>* paths, const std::uint32_t* path, const T* distance, const std::size_t &count,
+    vector<T, N>* out, const bool &parallel = true)
+{
+    MTP_PROFILE_OP(interpolation, count, count*(8*N+6));
+    parallel_for_chunks(plan_chunks(count, detail::spline_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for(std::size_t i = begin; i < end; i++) out[i] = paths[path[i]].at_distance(distance[i]);
+    });
+}
+
+using spline2f = spline<float, 2>;
+using spline3f = spline<float, 3>;
+using spline3d = spline<double, 3>;
+
+}
+
+#endif
@@ -0,0 +1,631 @@
+#ifndef STENCIL_HPP
+#define STENCIL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "sampler.hpp"
+#include "simd.hpp"
+
+namespace mtp {
+
+/*
+* Stencils and convolutions over dynamic_matrix (2D) and dynamic_matrix3d (3D).
+* dst(x, y) = sum kernel(kx, ky) * src(x + kx - rx, y + ky - ry), borders follow border_mode.
+*
+* A stencil object analyses its kernel once: separable (rank-1) floating point kernels run as
+* one 1D pass per axis inside of cache tiles with halos, everything else runs as one pass per
+* nonzero kernel row. Zero taps at the ends of rows are dropped, so sparse stencils (Laplacian)
+* only read what they use.
+*/
+
+/**
+* @brief Runtime 2D kernel of (2rx+1)x(2ry+1) weights, row-major: weights[ky*(2rx+1) + kx].
+*/
+template <typename T>
+struct kernel2d {
+    std::size_t rx = 0, ry = 0;
+    std::vector<T> weights;
+
+    kernel2d() : weights(1, T(1))
+    {
+
+    }
+
+    kernel2d(const std::size_t &rx, const std::size_t &ry) : rx(rx), ry(ry), weights((2*rx+1)*(2*ry+1), T(0))
+    {
+
+    }
+
+    kernel2d(const std::size_t &rx, const std::size_t &ry, std::initializer_list<T> list) : kernel2d(rx, ry)
+    {
+        std::copy(list.begin(), list.begin() + std::min(list.size(), weights.size()), weights.begin());
+    }
+
+    /* Compile-time kernel, both sizes must be odd. */
+    template <std::size_t KW, std::size_t KH>
+    kernel2d(const matrix<T, KW, KH> &k) : kernel2d(KW/2, KH/2)
+    {
+        static_assert(KW % 2 == 1 && KH % 2 == 1, "Kernel sizes must be odd.");
+        std::copy(k.data, k.data + KW*KH, weights.begin());
+    }
+
+    inline T& at(const std::size_t &kx, const std::size_t &ky) { return weights[ky*(2*rx+1)+kx]; }
+    inline const T& at(const std::size_t &kx, const std::size_t &ky) const { return weights[ky*(2*rx+1)+kx]; }
+
+    /* Separable kernel from its horizontal and vertical taps (odd counts). */
+    static kernel2d outer(const std::vector<T> &x, const std::vector<T> &y) {
+        kernel2d k(x.size()/2, y.size()/2);
+        for(std::size_t j = 0; j < y.size(); j++) {
+            for(std::size_t i = 0; i < x.size(); i++) k.at(i, j) = x[i] * y[j];
+        }
+        return k;
+    }
+};
+
+/**
+* @brief Runtime 3D kernel, layout follows dynamic_matrix3d: weights[(ky*(2rz+1) + kz)*(2rx+1) + kx].
+*/
+template <typename T>
+struct kernel3d {
+    std::size_t rx = 0, ry = 0, rz = 0;
+    std::vector<T> weights;
+
+    kernel3d() : weights(1, T(1))
+    {
+
+    }
+
+    kernel3d(const std::size_t &rx, const std::size_t &ry, const std::size_t &rz) :
+        rx(rx), ry(ry), rz(rz), weights((2*rx+1)*(2*ry+1)*(2*rz+1), T(0))
+    {
+
+    }
+
+    /* Compile-time kernel, all sizes must be odd. */
+    template <std::size_t KW, std::size_t KH, std::size_t KV>
+    kernel3d(const matrix3d<T, KW, KH, KV> &k) : kernel3d(KW/2, KH/2, KV/2)
+    {
+        static_assert(KW % 2 == 1 && KH % 2 == 1 && KV % 2 == 1, "Kernel sizes must be odd.");
+        std::copy(k.data, k.data + KW*KH*KV, weights.begin());
+    }
+
+    inline T& at(const std::size_t &kx, const std::size_t &ky, const std::size_t &kz) {
+        return weights[(ky*(2*rz+1)+kz)*(2*rx+1)+kx];
+    }
+    inline const T& at(const std::size_t &kx, const std::size_t &ky, const std::size_t &kz) const {
+        return weights[(ky*(2*rz+1)+kz)*(2*rx+1)+kx];
+    }
+
+    /* Separable kernel from its taps along x, y and z (odd counts). */
+    static kernel3d outer(const std::vector<T> &x, const std::vector<T> &y, const std::vector<T> &z) {
+        kernel3d k(x.size()/2, y.size()/2, z.size()/2);
+        for(std::size_t j = 0; j < y.size(); j++) {
+            for(std::size_t l = 0; l < z.size(); l++) {
+                for(std::size_t i = 0; i < x.size(); i++) k.at(i, j, l) = x[i] * y[j] * z[l];
+            }
+        }
+        return k;
+    }
+};
+
+/**
+* @brief Normalized gaussian taps.
+* @param radius taps on each side, 0 picks ceil(3 * sigma)
+*/
+template <typename T>
+std::vector<T> gaussian_taps(const T &sigma, std::size_t radius = 0) {
+    if(radius == 0) radius = static_cast<std::size_t>(std::ceil(3 * sigma));
+    std::vector<T> taps(2*radius+1);
+    T sum = T(0);
+    for(std::size_t i = 0; i < taps.size(); i++) {
+        const T d = static_cast<T>(static_cast<long long>(i) - static_cast<long long>(radius));
+        taps[i] = std::exp(-d*d / (2*sigma*sigma));
+        sum += taps[i];
+    }
+    for(T &t : taps) t /= sum;
+    return taps;
+}
+
+template <typename T>
+kernel2d<T> gaussian_kernel2d(const T &sigma, const std::size_t &radius = 0) {
+    const std::vector<T> taps = gaussian_taps(sigma, radius);
+    return kernel2d<T>::outer(taps, taps);
+}
+
+template <typename T>
+kernel3d<T> gaussian_kernel3d(const T &sigma, const std::size_t &radius = 0) {
+    const std::vector<T> taps = gaussian_taps(sigma, radius);
+    return kernel3d<T>::outer(taps, taps, taps);
+}
+
+/* 5-point Laplacian */
+template <typename T>
+kernel2d<T> laplacian_kernel2d() {
+    return kernel2d<T>(1, 1, {T(0), T(1), T(0), T(1), T(-4), T(1), T(0), T(1), T(0)});
+}
+
+/* 7-point Laplacian */
+template <typename T>
+kernel3d<T> laplacian_kernel3d() {
+    kernel3d<T> k(1, 1, 1);
+    k.at(1, 1, 1) = T(-6);
+    k.at(0, 1, 1) = k.at(2, 1, 1) = T(1);
+    k.at(1, 0, 1) = k.at(1, 2, 1) = T(1);
+    k.at(1, 1, 0) = k.at(1, 1, 2) = T(1);
+    return k;
+}
+
+namespace detail {
+
+/* Nonzero span of a row of taps: taps[k] applies to element x + offset + k. */
+template <typename T>
+struct stencil_row {
+    std::ptrdiff_t offset = 0;
+    std::vector<T> taps;
+};
+
+template <typename T>
+stencil_row<T> trim_taps(const T* taps, const std::size_t &count, const std::size_t &radius) {
+    std::size_t lo = 0, hi = count;
+    while(lo < hi && taps[lo] == T(0)) lo++;
+    while(hi > lo && taps[hi-1] == T(0)) hi--;
+    return {static_cast<std::ptrdiff_t>(lo) - static_cast<std::ptrdiff_t>(radius), std::vector<T>(taps + lo, taps + hi)};
+}
+
+inline std::size_t resolve_index(const std::ptrdiff_t &i, const std::size_t &n, const border_mode &mode) {
+    const std::ptrdiff_t size = static_cast<std::ptrdiff_t>(n);
+    if(i >= 0 && i < size) return static_cast<std::size_t>(i);
+    if(mode == border_mode::clamp) return i < 0 ? 0 : n - 1;
+    return static_cast<std::size_t>(((i % size) + size) % size);
+}
+
+/* out[x] (+)= sum taps[k] * src[x + k] for x in [0, len). N > 0 fixes the tap count at compile time. */
+template <std::size_t N, typename T>
+inline void convolve_span(const T* src, const T* taps, const std::size_t &count, T* out, const std::size_t &len, const bool &accumulate) {
+    const std::size_t taps_n = N ? N : count;
+    std::size_t x = 0;
+#if defined(MTP_AVX2)
+    if constexpr(std::is_same_v<T, float>) {
+        for(; x + 8 <= len; x += 8) {
+            __m256 acc = accumulate ? _mm256_loadu_ps(out + x) : _mm256_setzero_ps();
+            for(std::size_t k = 0; k < taps_n; k++) {
+#if defined(MTP_FMA)
+                acc = _mm256_fmadd_ps(_mm256_set1_ps(taps[k]), _mm256_loadu_ps(src + x + k), acc);
+#else
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(taps[k]), _mm256_loadu_ps(src + x + k)));
+#endif
+            }
+            _mm256_storeu_ps(out + x, acc);
+        }
+    }
+#endif
+    for(; x < len; x++) {
+        T sum = accumulate ? out[x] : T(0);
+        for(std::size_t k = 0; k < taps_n; k++) sum += taps[k] * src[x + k];
+        out[x] = sum;
+    }
+}
+
+/**
+* @brief Convolves elements [x0, x1) of a row of n elements, out[0] receives element x0.
+* Interior elements run through convolve_span, the few that reach over the border are resolved one by one.
+*/
+template <typename T>
+void convolve_row(const T* src, const std::size_t &n, const stencil_row<T> &row, const border_mode &mode,
+    T* out, const std::size_t &x0, const std::size_t &x1, const bool &accumulate)
+{
+    const std::size_t count = row.taps.size();
+    if(count == 0) {
+        if(!accumulate) std::fill(out, out + (x1 - x0), T(0));
+        return;
+    }
+
+    const std::ptrdiff_t first = -row.offset; /* first x that reads inside of the row */
+    const std::ptrdiff_t last = static_cast<std::ptrdiff_t>(n) - row.offset - static_cast<std::ptrdiff_t>(count) + 1;
+    const std::size_t lo = static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(first, x0, x1));
+    const std::size_t hi = static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(last, lo, x1));
+
+    auto edge = [&](const std::size_t &x) {
+        T sum = accumulate ? out[x - x0] : T(0);
+        for(std::size_t k = 0; k < count; k++) {
+            sum += row.taps[k] * src[resolve_index(static_cast<std::ptrdiff_t>(x) + row.offset + static_cast<std::ptrdiff_t>(k), n, mode)];
+        }
+        out[x - x0] = sum;
+    };
+    for(std::size_t x = x0; x < lo; x++) edge(x);
+    for(std::size_t x = hi; x < x1; x++) edge(x);
+    if(lo >= hi) return;
+
+    const T* s = src + static_cast<std::ptrdiff_t>(lo) + row.offset;
+    const T* t = row.taps.data();
+    T* o = out + (lo - x0);
+    const std::size_t len = hi - lo;
+    switch(count) {
+        case 1: convolve_span<1>(s, t, count, o, len, accumulate); break;
+        case 2: convolve_span<2>(s, t, count, o, len, accumulate); break;
+        case 3: convolve_span<3>(s, t, count, o, len, accumulate); break;
+        case 4: convolve_span<4>(s, t, count, o, len, accumulate); break;
+        case 5: convolve_span<5>(s, t, count, o, len, accumulate); break;
+        case 7: convolve_span<7>(s, t, count, o, len, accumulate); break;
+        default: convolve_span<0>(s, t, count, o, len, accumulate); break;
+    }
+}
+
+/* out[x] = sum weights[k] * rows[k][x] for x in [0, len), a 1D pass across rows. */
+template <typename T>
+void combine_rows(const T* const* rows, const T* weights, const std::size_t &count, T* out, const std::size_t &len) {
+    std::size_t x = 0;
+#if defined(MTP_AVX2)
+    if constexpr(std::is_same_v<T, float>) {
+        for(; x + 8 <= len; x += 8) {
+            __m256 acc = _mm256_setzero_ps();
+            for(std::size_t k = 0; k < count; k++) {
+#if defined(MTP_FMA)
+                acc = _mm256_fmadd_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + x), acc);
+#else
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + x)));
+#endif
+            }
+            _mm256_storeu_ps(out + x, acc);
+        }
+    }
+#endif
+    for(; x < len; x++) {
+        T sum = T(0);
+        for(std::size_t k = 0; k < count; k++) sum += weights[k] * rows[k][x];
+        out[x] = sum;
+    }
+}
+
+/**
+* @brief Factors a 2D (or flattened 3D) kernel into rank-1 axis taps when it is one.
+* @param axes sizes of the axes, slowest first; taps receives one vector per axis.
+*/
+template <typename T>
+bool factor_kernel(const std::vector<T> &weights, const std::vector<std::size_t> &axes, std::vector<std::vector<T>> &taps) {
+    if constexpr(!std::is_floating_point_v<T>) {
+        return false;
+    } else {
+        std::size_t pivot = 0;
+        for(std::size_t i = 1; i < weights.size(); i++) {
+            if(std::abs(weights[i]) > std::abs(weights[pivot])) pivot = i;
+        }
+        const T peak = weights[pivot];
+        if(peak == T(0)) return false;
+
+        /* coordinates of the pivot along every axis */
+        std::vector<std::size_t> coord(axes.size()), stride(axes.size());
+        std::size_t s = 1;
+        for(std::size_t a = axes.size(); a-- > 0;) { stride[a] = s; s *= axes[a]; }
+        for(std::size_t a = 0; a < axes.size(); a++) coord[a] = (pivot / stride[a]) % axes[a];
+
+        /* every axis gets the line through the pivot, the first one keeps the scale */
+        taps.assign(axes.size(), {});
+        for(std::size_t a = 0; a < axes.size(); a++) {
+            taps[a].resize(axes[a]);
+            const std::size_t base = pivot - coord[a]*stride[a];
+            for(std::size_t i = 0; i < axes[a]; i++) taps[a][i] = weights[base + i*stride[a]] / (a == 0 ? T(1) : peak);
+        }
+
+        const T tolerance = std::abs(peak) * std::numeric_limits<T>::epsilon() * 64;
+        for(std::size_t i = 0; i < weights.size(); i++) {
+            T product = T(1);
+            for(std::size_t a = 0; a < axes.size(); a++) product *= taps[a][(i / stride[a]) % axes[a]];
+            if(std::abs(product - weights[i]) > tolerance) return false;
+        }
+        return true;
+    }
+}
+
+/* Tile sizes: 2D tiles are stencil_tile_rows x stencil_tile_width, 3D tiles cover full rows. */
+constexpr std::size_t stencil_tile_width = 1024;
+constexpr std::size_t stencil_tile_rows = 32;
+constexpr std::size_t stencil_tile_y = 8;
+constexpr std::size_t stencil_tile_z = 16;
+
+}
+
+/**
+* @brief Prepared 2D stencil. Build it once and apply it to any number of grids.
+*/
+template <typename T>
+struct stencil2d {
+    border_mode mode;
+    bool separable = false;
+
+    /* separable: one pass per axis */
+    detail::stencil_row<T> along_x, along_y;
+
+    /* dense: nonzero kernel rows with their y offsets */
+    std::vector<std::pair<std::ptrdiff_t, detail::stencil_row<T>>> rows;
+
+    explicit stencil2d(const kernel2d<T> &kernel, const border_mode &mode = border_mode::clamp) : mode(mode) {
+        const std::size_t kw = 2*kernel.rx+1, kh = 2*kernel.ry+1;
+        for(std::size_t ky = 0; ky < kh; ky++) {
+            detail::stencil_row<T> row = detail::trim_taps(kernel.weights.data() + ky*kw, kw, kernel.rx);
+            if(!row.taps.empty()) rows.emplace_back(static_cast<std::ptrdiff_t>(ky) - static_cast<std::ptrdiff_t>(kernel.ry), std::move(row));
+        }
+
+        std::vector<std::vector<T>> taps;
+        if(rows.size() > 1 && detail::factor_kernel(kernel.weights, {kh, kw}, taps)) {
+            along_y = detail::trim_taps(taps[0].data(), kh, kernel.ry);
+            along_x = detail::trim_taps(taps[1].data(), kw, kernel.rx);
+
+            std::size_t dense = 0;
+            for(const auto &r : rows) dense += r.second.taps.size();
+            separable = along_x.taps.size() + along_y.taps.size() < dense;
+        }
+    }
+
+    /**
+    * @brief dst = kernel applied to src. dst is resized to src when the sizes differ, src == dst is allowed.
+    * @param parallel splits the tiles between hardware threads
+    */
+    template <std::size_t Inline>
+    void apply(const dynamic_matrix<T, Inline> &src, dynamic_matrix<T, Inline> &dst, const bool &parallel = true) const {
+        if(&src == &dst || src.data == dst.data) {
+            dynamic_matrix<T, Inline> result(src.n, src.m);
+            apply(src, result, parallel);
+            dst.swap(result);
+            return;
+        }
+        if(dst.n != src.n || dst.m != src.m || dst.is_shared()) dst.resize(src.n, src.m);
+
+        const std::size_t n = src.n, m = src.m;
+        const std::size_t tiles_x = (n + detail::stencil_tile_width - 1) / detail::stencil_tile_width;
+        const std::size_t tiles_y = (m + detail::stencil_tile_rows - 1) / detail::stencil_tile_rows;
+        MTP_PROFILE_OP(container, n*m, 2*n*m*(separable ? along_x.taps.size() + along_y.taps.size() : dense_taps()));
+
+        parallel_for_chunks(plan_chunks(tiles_x*tiles_y, 1, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+            std::vector<T> scratch;
+            std::vector<const T*> inputs;
+            for(std::size_t tile = begin; tile < end; tile++) {
+                const std::size_t x0 = (tile % tiles_x) * detail::stencil_tile_width;
+                const std::size_t y0 = (tile / tiles_x) * detail::stencil_tile_rows;
+                const std::size_t x1 = std::min(n, x0 + detail::stencil_tile_width);
+                const std::size_t y1 = std::min(m, y0 + detail::stencil_tile_rows);
+                if(separable) separable_tile(src, dst, x0, x1, y0, y1, scratch, inputs);
+                else dense_tile(src, dst, x0, x1, y0, y1);
+            }
+        });
+    }
+
+    /**
+    * @brief Applies the stencil steps times in place, ping-ponging between the grid and one scratch buffer.
+    */
+    template <std::size_t Inline>
+    void iterate(dynamic_matrix<T, Inline> &grid, const std::size_t &steps, const bool &parallel = true) const {
+        if(steps == 0) return;
+        dynamic_matrix<T, Inline> other(grid.n, grid.m);
+        for(std::size_t s = 0; s < steps; s++) {
+            apply(grid, other, parallel);
+            grid.swap(other);
+        }
+    }
+
+private:
+    std::size_t dense_taps() const {
+        std::size_t count = 0;
+        for(const auto &r : rows) count += r.second.taps.size();
+        return count;
+    }
+
+    template <std::size_t Inline>
+    void dense_tile(const dynamic_matrix<T, Inline> &src, dynamic_matrix<T, Inline> &dst,
+        const std::size_t &x0, const std::size_t &x1, const std::size_t &y0, const std::size_t &y1) const
+    {
+        const std::size_t n = src.n;
+        for(std::size_t y = y0; y < y1; y++) {
+            T* out = dst.data + y*n + x0;
+            if(rows.empty()) std::fill(out, out + (x1 - x0), T(0));
+            bool accumulate = false;
+            for(const auto &r : rows) {
+                const std::size_t sy = detail::resolve_index(static_cast<std::ptrdiff_t>(y) + r.first, src.m, mode);
+                detail::convolve_row(src.data + sy*n, n, r.second, mode, out, x0, x1, accumulate);
+                accumulate = true;
+            }
+        }
+    }
+
+    /* horizontal pass over the tile rows plus the vertical halo into scratch, then the vertical pass into dst */
+    template <std::size_t Inline>
+    void separable_tile(const dynamic_matrix<T, Inline> &src, dynamic_matrix<T, Inline> &dst,
+        const std::size_t &x0, const std::size_t &x1, const std::size_t &y0, const std::size_t &y1,
+        std::vector<T> &scratch, std::vector<const T*> &inputs) const
+    {
+        const std::size_t n = src.n, tw = x1 - x0;
+        const std::size_t ky = along_y.taps.size();
+        const std::size_t halo_rows = (y1 - y0) + ky - 1;
+        const std::ptrdiff_t first = static_cast<std::ptrdiff_t>(y0) + along_y.offset;
+        scratch.resize(halo_rows*tw);
+
+        for(std::size_t r = 0; r < halo_rows; r++) {
+            const std::size_t sy = detail::resolve_index(first + static_cast<std::ptrdiff_t>(r), src.m, mode);
+            detail::convolve_row(src.data + sy*n, n, along_x, mode, scratch.data() + r*tw, x0, x1, false);
+        }
+
+        inputs.resize(ky);
+        for(std::size_t y = y0; y < y1; y++) {
+            for(std::size_t k = 0; k < ky; k++) inputs[k] = scratch.data() + (y - y0 + k)*tw;
+            detail::combine_rows(inputs.data(), along_y.taps.data(), ky, dst.data + y*n + x0, tw);
+        }
+    }
+};
+
+/**
+* @brief Prepared 3D stencil. Build it once and apply it to any number of grids.
+*/
+template <typename T>
+struct stencil3d {
+    border_mode mode;
+    bool separable = false;
+
+    /* separable: one pass per axis */
+    detail::stencil_row<T> along_x, along_y, along_z;
+
+    /* dense: nonzero kernel rows with their y and z offsets */
+    struct offset_row {
+        std::ptrdiff_t dy, dz;
+        detail::stencil_row<T> row;
+    };
+    std::vector<offset_row> rows;
+
+    explicit stencil3d(const kernel3d<T> &kernel, const border_mode &mode = border_mode::clamp) : mode(mode) {
+        const std::size_t kw = 2*kernel.rx+1, kh = 2*kernel.ry+1, kv = 2*kernel.rz+1;
+        for(std::size_t ky = 0; ky < kh; ky++) {
+            for(std::size_t kz = 0; kz < kv; kz++) {
+                detail::stencil_row<T> row = detail::trim_taps(kernel.weights.data() + (ky*kv+kz)*kw, kw, kernel.rx);
+                if(row.taps.empty()) continue;
+                rows.push_back({static_cast<std::ptrdiff_t>(ky) - static_cast<std::ptrdiff_t>(kernel.ry),
+                                static_cast<std::ptrdiff_t>(kz) - static_cast<std::ptrdiff_t>(kernel.rz), std::move(row)});
+            }
+        }
+
+        std::vector<std::vector<T>> taps;
+        if(rows.size() > 1 && detail::factor_kernel(kernel.weights, {kh, kv, kw}, taps)) {
+            along_y = detail::trim_taps(taps[0].data(), kh, kernel.ry);
+            along_z = detail::trim_taps(taps[1].data(), kv, kernel.rz);
+            along_x = detail::trim_taps(taps[2].data(), kw, kernel.rx);
+            separable = along_x.taps.size() + along_y.taps.size() + along_z.taps.size() < dense_taps();
+        }
+    }
+
+    /**
+    * @brief dst = kernel applied to src. dst is resized to src when the sizes differ, src == dst is allowed.
+    * @param parallel splits the tiles between hardware threads
+    */
+    template <std::size_t Inline>
+    void apply(const dynamic_matrix3d<T, Inline> &src, dynamic_matrix3d<T, Inline> &dst, const bool &parallel = true) const {
+        if(&src == &dst || src.data == dst.data) {
+            dynamic_matrix3d<T, Inline> result(src.w, src.h, src.v);
+            apply(src, result, parallel);
+            dst.swap(result);
+            return;
+        }
+        if(dst.w != src.w || dst.h != src.h || dst.v != src.v || dst.is_shared()) dst.resize(src.w, src.h, src.v);
+
+        const std::size_t tiles_y = (src.h + detail::stencil_tile_y - 1) / detail::stencil_tile_y;
+        const std::size_t tiles_z = (src.v + detail::stencil_tile_z - 1) / detail::stencil_tile_z;
+        MTP_PROFILE_OP(container, src.w*src.h*src.v, 2*src.w*src.h*src.v*(separable ? along_x.taps.size() + along_y.taps.size() + along_z.taps.size() : dense_taps()));
+
+        parallel_for_chunks(plan_chunks(tiles_y*tiles_z, 1, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+            std::vector<T> scratch_x, scratch_z;
+            std::vector<const T*> inputs;
+            for(std::size_t tile = begin; tile < end; tile++) {
+                const std::size_t y0 = (tile / tiles_z) * detail::stencil_tile_y;
+                const std::size_t z0 = (tile % tiles_z) * detail::stencil_tile_z;
+                const std::size_t y1 = std::min(src.h, y0 + detail::stencil_tile_y);
+                const std::size_t z1 = std::min(src.v, z0 + detail::stencil_tile_z);
+                if(separable) separable_tile(src, dst, y0, y1, z0, z1, scratch_x, scratch_z, inputs);
+                else dense_tile(src, dst, y0, y1, z0, z1);
+            }
+        });
+    }
+
+    /**
+    * @brief Applies the stencil steps times in place, ping-ponging between the grid and one scratch buffer.
+    */
+    template <std::size_t Inline>
+    void iterate(dynamic_matrix3d<T, Inline> &grid, const std::size_t &steps, const bool &parallel = true) const {
+        if(steps == 0) return;
+        dynamic_matrix3d<T, Inline> other(grid.w, grid.h, grid.v);
+        for(std::size_t s = 0; s < steps; s++) {
+            apply(grid, other, parallel);
+            grid.swap(other);
+        }
+    }
+
+private:
+    std::size_t dense_taps() const {
+        std::size_t count = 0;
+        for(const offset_row &r : rows) count += r.row.taps.size();
+        return count;
+    }
+
+    template <std::size_t Inline>
+    void dense_tile(const dynamic_matrix3d<T, Inline> &src, dynamic_matrix3d<T, Inline> &dst,
+        const std::size_t &y0, const std::size_t &y1, const std::size_t &z0, const std::size_t &z1) const
+    {
+        const std::size_t w = src.w;
+        for(std::size_t y = y0; y < y1; y++) {
+            for(std::size_t z = z0; z < z1; z++) {
+                T* out = dst.data + dst.index(0, y, z);
+                if(rows.empty()) std::fill(out, out + w, T(0));
+                bool accumulate = false;
+                for(const offset_row &r : rows) {
+                    const std::size_t sy = detail::resolve_index(static_cast<std::ptrdiff_t>(y) + r.dy, src.h, mode);
+                    const std::size_t sz = detail::resolve_index(static_cast<std::ptrdiff_t>(z) + r.dz, src.v, mode);
+                    detail::convolve_row(src.data + src.index(0, sy, sz), w, r.row, mode, out, 0, w, accumulate);
+                    accumulate = true;
+                }
+            }
+        }
+    }
+
+    /* x pass over the tile plus its y/z halo, z pass over the tile plus its y halo, y pass into dst */
+    template <std::size_t Inline>
+    void separable_tile(const dynamic_matrix3d<T, Inline> &src, dynamic_matrix3d<T, Inline> &dst,
+        const std::size_t &y0, const std::size_t &y1, const std::size_t &z0, const std::size_t &z1,
+        std::vector<T> &scratch_x, std::vector<T> &scratch_z, std::vector<const T*> &inputs) const
+    {
+        const std::size_t w = src.w;
+        const std::size_t ky = along_y.taps.size(), kz = along_z.taps.size();
+        const std::size_t rows_y = (y1 - y0) + ky - 1, rows_z = (z1 - z0) + kz - 1, tile_z = z1 - z0;
+        const std::ptrdiff_t first_y = static_cast<std::ptrdiff_t>(y0) + along_y.offset;
+        const std::ptrdiff_t first_z = static_cast<std::ptrdiff_t>(z0) + along_z.offset;
+        scratch_x.resize(rows_y*rows_z*w);
+        scratch_z.resize(rows_y*tile_z*w);
+
+        for(std::size_t ry = 0; ry < rows_y; ry++) {
+            const std::size_t sy = detail::resolve_index(first_y + static_cast<std::ptrdiff_t>(ry), src.h, mode);
+            for(std::size_t rz = 0; rz < rows_z; rz++) {
+                const std::size_t sz = detail::resolve_index(first_z + static_cast<std::ptrdiff_t>(rz), src.v, mode);
+                detail::convolve_row(src.data + src.index(0, sy, sz), w, along_x, mode, scratch_x.data() + (ry*rows_z + rz)*w, 0, w, false);
+            }
+        }
+
+        inputs.resize(std::max(ky, kz));
+        for(std::size_t ry = 0; ry < rows_y; ry++) {
+            for(std::size_t z = 0; z < tile_z; z++) {
+                for(std::size_t k = 0; k < kz; k++) inputs[k] = scratch_x.data() + (ry*rows_z + z + k)*w;
+                detail::combine_rows(inputs.data(), along_z.taps.data(), kz, scratch_z.data() + (ry*tile_z + z)*w, w);
+            }
+        }
+
+        for(std::size_t y = y0; y < y1; y++) {
+            for(std::size_t z = 0; z < tile_z; z++) {
+                for(std::size_t k = 0; k < ky; k++) inputs[k] = scratch_z.data() + ((y - y0 + k)*tile_z + z)*w;
+                detail::combine_rows(inputs.data(), along_y.taps.data(), ky, dst.data + dst.index(0, y, z0 + z), w);
+            }
+        }
+    }
+};
+
+/**
+* @brief One-shot convolution, prepares the stencil on every call.
+*/
+template <typename T, std::size_t Inline>
+void convolve(const dynamic_matrix<T, Inline> &src, dynamic_matrix<T, Inline> &dst, const kernel2d<T> &kernel,
+    const border_mode &mode = border_mode::clamp, const bool &parallel = true)
+{
+    stencil2d<T>(kernel, mode).apply(src, dst, parallel);
+}
+
+template <typename T, std::size_t Inline>
+void convolve(const dynamic_matrix3d<T, Inline> &src, dynamic_matrix3d<T, Inline> &dst, const kernel3d<T> &kernel,
+    const border_mode &mode = border_mode::clamp, const bool &parallel = true)
+{
+    stencil3d<T>(kernel, mode).apply(src, dst, parallel);
+}
+
+}
+
+#endif
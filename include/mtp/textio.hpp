@@ -0,0 +1,406 @@
+#ifndef TEXTIO_HPP
+#define TEXTIO_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+
+namespace mtp {
+
+/*
+* Numeric text ingest/export for dynamic_matrix: one matrix row per line, fields separated by a delimiter.
+* The file is read in chunks cut at line boundaries, every chunk is split into per-thread ranges at line
+* boundaries and parsed with std::from_chars straight into the rows of the matrix.
+* Blank lines are skipped, "\r\n" line endings are accepted.
+*/
+
+struct text_format {
+    char delimiter = ',';   /* ' ' splits on runs of spaces and tabs */
+    bool header = false;    /* skip the first non-blank line */
+    int precision = -1;     /* writer: significant digits of floating point values, -1 - shortest round-trip form */
+
+    static constexpr text_format csv() { return {',', false, -1}; }
+    static constexpr text_format tsv() { return {'\t', false, -1}; }
+    static constexpr text_format whitespace() { return {' ', false, -1}; }
+};
+
+enum class text_status {
+    ok,
+    open_failed,
+    read_failed,
+    write_failed,
+    bad_value,  /* a field is not a number of the element type */
+    ragged_row, /* a row has a different number of fields than the first one */
+    row_count   /* the file has a different number of rows than the pre-sized matrix */
+};
+
+struct text_result {
+    text_status status = text_status::ok;
+    std::size_t line = 0; /* 1-based line of the error, 0 if it isn't tied to a line */
+
+    inline explicit operator bool() const { return status == text_status::ok; }
+};
+
+namespace detail {
+
+/* Bytes per parallel range */
+constexpr std::size_t text_grain = 1 << 16;
+
+/* Bytes read from the file at once */
+constexpr std::size_t text_chunk = 1 << 24;
+
+inline bool blank_line(const char* b, const char* e) {
+    for(; b < e; b++) {
+        if(*b != ' ' && *b != '\t' && *b != '\r') return false;
+    }
+    return true;
+}
+
+inline const char* line_end(const char* b, const char* e) {
+    const void* p = std::memchr(b, '\n', static_cast<std::size_t>(e - b));
+    return p ? static_cast<const char*>(p) : e;
+}
+
+/* Start of the line following p (or e). */
+inline const char* next_line(const char* p, const char* e) {
+    const char* l = line_end(p, e);
+    return l == e ? e : l + 1;
+}
+
+/* Skips the first non-blank line, returns the start of the data and counts the skipped lines. */
+inline const char* skip_header(const char* b, const char* e, std::size_t &lines, bool &pending) {
+    while(pending && b < e) {
+        const char* l = line_end(b, e);
+        if(!blank_line(b, l)) pending = false;
+        lines++;
+        b = l == e ? e : l + 1;
+    }
+    return b;
+}
+
+/**
+* @brief Parses the fields of one line. out may be nullptr to only count them.
+* @return number of fields, or -1 if a field is not a number.
+*/
+template <typename T>
+inline std::ptrdiff_t parse_fields(const char* p, const char* e, const char &delimiter, T* out, const std::size_t &cols) {
+    if(e > p && e[-1] == '\r') e--;
+    const bool whitespace = delimiter == ' ';
+    auto space = [&](const char &c) { return c == ' ' || (c == '\t' && delimiter != '\t'); };
+
+    std::size_t fields = 0;
+    while(true) {
+        while(p < e && space(*p)) p++;
+        if(whitespace && p == e) break;
+        if(p < e && *p == '+') p++;
+
+        T value;
+        const std::from_chars_result r = std::from_chars(p, e, value);
+        if(r.ec != std::errc()) return -1;
+        if(out && fields < cols) out[fields] = value;
+        fields++;
+
+        p = r.ptr;
+        while(p < e && space(*p)) p++;
+        if(p == e) break;
+        if(!whitespace) {
+            if(*p != delimiter) return -1;
+            p++;
+        }
+    }
+    return static_cast<std::ptrdiff_t>(fields);
+}
+
+/* Lines and non-blank lines of a range that starts at a line boundary. */
+struct text_count {
+    std::size_t lines = 0;
+    std::size_t rows = 0;
+};
+
+inline text_count count_rows(const char* b, const char* e) {
+    text_count count;
+    while(b < e) {
+        const char* l = line_end(b, e);
+        count.lines++;
+        if(!blank_line(b, l)) count.rows++;
+        b = l == e ? e : l + 1;
+    }
+    return count;
+}
+
+/* Splits [b, e) into ranges that start at line boundaries. */
+inline std::vector<const char*> split_lines(const char* b, const char* e, const bool &parallel) {
+    const chunk_plan plan = plan_chunks(static_cast<std::size_t>(e - b), text_grain, parallel ? 0 : 1);
+    std::vector<const char*> bounds{b};
+    for(std::size_t c = 1; c < plan.chunks; c++) {
+        const char* p = next_line(std::max(bounds.back(), b + c*plan.chunk_size - 1), e);
+        if(p < e) bounds.push_back(p);
+    }
+    bounds.push_back(e);
+    return bounds;
+}
+
+/**
+* @brief Parses a block of whole lines into rows [row, row + block rows) of out.
+* Advances row and line past the block, the earliest error wins.
+*/
+template <typename T, std::size_t Inline>
+text_result parse_block(const char* b, const char* e, dynamic_matrix<T, Inline> &out, const text_format &fmt,
+    std::size_t &row, std::size_t &line, const bool &parallel)
+{
+    const std::vector<const char*> bounds = split_lines(b, e, parallel);
+    const std::size_t ranges = bounds.size() - 1;
+
+    std::vector<text_count> counts(ranges);
+    parallel_for_chunks(plan_chunks(ranges, 1, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for(std::size_t r = begin; r < end; r++) counts[r] = count_rows(bounds[r], bounds[r+1]);
+    });
+
+    std::vector<text_result> results(ranges);
+    std::vector<std::size_t> first_row(ranges), first_line(ranges);
+    for(std::size_t r = 0; r < ranges; r++) {
+        first_row[r] = row;
+        first_line[r] = line + 1;
+        row += counts[r].rows;
+        line += counts[r].lines;
+    }
+
+    const std::size_t cols = out.n, rows = out.m;
+    parallel_for_chunks(plan_chunks(ranges, 1, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for(std::size_t r = begin; r < end; r++) {
+            std::size_t y = first_row[r], l = first_line[r];
+            for(const char* p = bounds[r]; p < bounds[r+1]; l++) {
+                const char* le = line_end(p, bounds[r+1]);
+                if(!blank_line(p, le)) {
+                    if(y >= rows) {
+                        results[r] = {text_status::row_count, l};
+                        break;
+                    }
+                    const std::ptrdiff_t fields = parse_fields(p, le, fmt.delimiter, out.data + y*cols, cols);
+                    if(fields < 0 || static_cast<std::size_t>(fields) != cols) {
+                        results[r] = {fields < 0 ? text_status::bad_value : text_status::ragged_row, l};
+                        break;
+                    }
+                    y++;
+                }
+                p = le == bounds[r+1] ? le : le + 1;
+            }
+        }
+    });
+
+    for(const text_result &r : results) {
+        if(!r) return r;
+    }
+    return {};
+}
+
+/**
+* @brief Calls fn(begin, end) for blocks of whole lines read from the file about chunk bytes at a time.
+* fn returns false to stop reading.
+* @return false on a read error.
+*/
+template <typename Fn>
+bool for_each_line_block(std::FILE* file, const std::size_t &chunk, Fn&& fn) {
+    std::vector<char> buffer(chunk);
+    std::size_t carry = 0;
+    while(true) {
+        if(carry == buffer.size()) buffer.resize(buffer.size() * 2); /* line longer than the buffer */
+        const std::size_t got = std::fread(buffer.data() + carry, 1, buffer.size() - carry, file);
+        if(got == 0) {
+            if(std::ferror(file)) return false;
+            if(carry) fn(buffer.data(), buffer.data() + carry);
+            return true;
+        }
+
+        const char* b = buffer.data();
+        const char* e = b + carry + got;
+        const char* cut = e;
+        while(cut > b && cut[-1] != '\n') cut--;
+        carry = static_cast<std::size_t>(e - cut);
+        if(cut > b && !fn(b, cut)) return true;
+        std::memmove(buffer.data(), cut, carry);
+    }
+}
+
+/* Characters needed by one formatted value plus its delimiter. */
+template <typename T>
+constexpr std::size_t value_chars(const int &precision) {
+    return (std::is_floating_point_v<T> && precision > 0 ? static_cast<std::size_t>(precision) : 0) + 32;
+}
+
+template <typename T>
+inline char* format_value(char* p, char* e, const T &value, const int &precision) {
+    if constexpr(std::is_floating_point_v<T>) {
+        if(precision >= 0) return std::to_chars(p, e, value, std::chars_format::general, precision).ptr;
+    }
+    return std::to_chars(p, e, value).ptr;
+}
+
+}
+
+/**
+* @brief Parses text held in memory into out.
+* A matrix with elements is treated as pre-sized: its width and height must match the text.
+* An empty matrix is sized from the number of non-blank lines and the fields of the first one.
+* @param parallel splits the text between hardware threads
+*/
+template <typename T, std::size_t Inline>
+text_result parse_text(const char* begin, const char* end, dynamic_matrix<T, Inline> &out,
+    const text_format &fmt = text_format::csv(), const bool &parallel = true)
+{
+    std::size_t row = 0, line = 0;
+    bool header = fmt.header;
+    begin = detail::skip_header(begin, end, line, header);
+
+    if(out.n*out.m == 0) {
+        const std::vector<const char*> bounds = detail::split_lines(begin, end, parallel);
+        std::vector<detail::text_count> counts(bounds.size() - 1);
+        parallel_for_chunks(plan_chunks(counts.size(), 1, parallel ? 0 : 1), [&](std::size_t, std::size_t b, std::size_t e) {
+            for(std::size_t r = b; r < e; r++) counts[r] = detail::count_rows(bounds[r], bounds[r+1]);
+        });
+        std::size_t rows = 0;
+        for(const detail::text_count &c : counts) rows += c.rows;
+
+        std::size_t cols = 0, first = line + 1;
+        for(const char* p = begin; p < end; p = detail::next_line(p, end), first++) {
+            const char* le = detail::line_end(p, end);
+            if(detail::blank_line(p, le)) continue;
+            const std::ptrdiff_t fields = detail::parse_fields<T>(p, le, fmt.delimiter, nullptr, 0);
+            if(fields < 0) return {text_status::bad_value, first};
+            cols = static_cast<std::size_t>(fields);
+            break;
+        }
+        out.resize(cols, rows);
+    } else if(out.is_shared()) {
+        out.resize(out.n, out.m);
+    }
+
+    const text_result result = detail::parse_block(begin, end, out, fmt, row, line, parallel);
+    if(!result) return result;
+    if(row != out.m) return {text_status::row_count, 0};
+    return result;
+}
+
+/**
+* @brief Loads a text file into out, reading it in chunks.
+* A matrix with elements is treated as pre-sized and is filled in a single pass, an empty one is
+* sized by a first counting pass over the file.
+* @param parallel splits every chunk between hardware threads
+*/
+template <typename T, std::size_t Inline>
+text_result load_text(const char* path, dynamic_matrix<T, Inline> &out,
+    const text_format &fmt = text_format::csv(), const bool &parallel = true)
+{
+    std::FILE* file = std::fopen(path, "rb");
+    if(!file) return {text_status::open_failed, 0};
+
+    text_result result;
+    if(out.n*out.m == 0) {
+        std::size_t rows = 0, cols = 0, line = 0;
+        bool header = fmt.header, first = true;
+        const bool read = detail::for_each_line_block(file, detail::text_chunk, [&](const char* b, const char* e) {
+            b = detail::skip_header(b, e, line, header);
+            for(const char* p = b; first && p < e; p = detail::next_line(p, e)) {
+                line++;
+                const char* le = detail::line_end(p, e);
+                if(detail::blank_line(p, le)) continue;
+                const std::ptrdiff_t fields = detail::parse_fields<T>(p, le, fmt.delimiter, nullptr, 0);
+                if(fields < 0) {
+                    result = {text_status::bad_value, line};
+                    return false;
+                }
+                cols = static_cast<std::size_t>(fields);
+                first = false;
+            }
+            rows += detail::count_rows(b, e).rows;
+            return true;
+        });
+        if(!read) result = {text_status::read_failed, 0};
+        if(!result) {
+            std::fclose(file);
+            return result;
+        }
+        out.resize(cols, rows);
+        std::rewind(file);
+    } else if(out.is_shared()) {
+        out.resize(out.n, out.m);
+    }
+
+    std::size_t row = 0, line = 0;
+    bool header = fmt.header;
+    const bool read = detail::for_each_line_block(file, detail::text_chunk, [&](const char* b, const char* e) {
+        b = detail::skip_header(b, e, line, header);
+        result = detail::parse_block(b, e, out, fmt, row, line, parallel);
+        return static_cast<bool>(result);
+    });
+    std::fclose(file);
+
+    if(!read) return {text_status::read_failed, 0};
+    if(result && row != out.m) return {text_status::row_count, 0};
+    return result;
+}
+
+/**
+* @brief Writes the matrix as text, one row per line. Rows are formatted with std::to_chars in parallel
+* into per-thread buffers and written in order.
+*/
+template <typename T, std::size_t Inline>
+text_result write_text(std::FILE* file, const dynamic_matrix<T, Inline> &m,
+    const text_format &fmt = text_format::csv(), const bool &parallel = true)
+{
+    const std::size_t cols = m.n, rows = m.m;
+    const char delimiter = fmt.delimiter;
+    const std::size_t row_chars = cols * detail::value_chars<T>(fmt.precision) + 1;
+    const std::size_t block_rows = std::max<std::size_t>(1, detail::text_chunk / row_chars);
+
+    for(std::size_t r0 = 0; r0 < rows; r0 += block_rows) {
+        const std::size_t r1 = std::min(rows, r0 + block_rows);
+        const chunk_plan plan = plan_chunks(r1 - r0, 64, parallel ? 0 : 1);
+        std::vector<std::vector<char>> text(plan.chunks);
+
+        parallel_for_chunks(plan, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            std::vector<char> &buffer = text[chunk];
+            buffer.resize((end - begin) * row_chars);
+            char* p = buffer.data();
+            char* e = p + buffer.size();
+            for(std::size_t y = r0 + begin; y < r0 + end; y++) {
+                const T* row = m.data + y*cols;
+                for(std::size_t x = 0; x < cols; x++) {
+                    if(x) *p++ = delimiter;
+                    p = detail::format_value(p, e, row[x], fmt.precision);
+                }
+                *p++ = '\n';
+            }
+            buffer.resize(static_cast<std::size_t>(p - buffer.data()));
+        });
+
+        for(const std::vector<char> &buffer : text) {
+            if(std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) return {text_status::write_failed, 0};
+        }
+    }
+    return {};
+}
+
+/**
+* @brief Writes the matrix into a text file, see write_text().
+*/
+template <typename T, std::size_t Inline>
+text_result save_text(const char* path, const dynamic_matrix<T, Inline> &m,
+    const text_format &fmt = text_format::csv(), const bool &parallel = true)
+{
+    std::FILE* file = std::fopen(path, "wb");
+    if(!file) return {text_status::open_failed, 0};
+    text_result result = write_text(file, m, fmt, parallel);
+    if(std::fclose(file) != 0 && result) result = {text_status::write_failed, 0};
+    return result;
+}
+
+}
+
+#endif
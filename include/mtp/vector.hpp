@@ -5,17 +5,17 @@
 
 namespace mtp {
 
-template <typename T, std::size_t N, std::size_t Precition = 6>
-struct vector : public DataContainer<T, N, Precition> {
-    constexpr vector() : DataContainer<T, N, Precition>() {}
+template <typename T, std::size_t N, std::size_t Precition = 6, typename Storage = storage_legacy>
+struct vector : public DataContainer<T, N, Precition, Storage> {
+    constexpr vector() : DataContainer<T, N, Precition, Storage>() {}
 
-    constexpr vector(T scalar) : DataContainer<T, N, Precition>(scalar) {}
+    constexpr vector(T scalar) : DataContainer<T, N, Precition, Storage>(scalar) {}
 
     template <typename U = T, typename... Args, typename = std::enable_if_t<sizeof...(Args) == N>>
-    constexpr vector(const Args&... args) : DataContainer<T, N, Precition>(args...) {}
+    constexpr vector(const Args&... args) : DataContainer<T, N, Precition, Storage>(args...) {}
 
-    template <std::size_t NN, typename... Args, typename = std::enable_if_t<sizeof...(Args) + NN == N>>
-    constexpr vector(const vector<T, NN> &vec, const Args&... args) {
+    template <std::size_t NN, std::size_t P, typename S, typename... Args, typename = std::enable_if_t<sizeof...(Args) + NN == N>>
+    constexpr vector(const vector<T, NN, P, S> &vec, const Args&... args) {
         std::copy(vec.data, vec.data+NN, this->data);
 
         std::size_t i = NN;
@@ -26,10 +26,13 @@ struct vector : public DataContainer<T, N, Precition> {
 
     constexpr vector(const vector&) noexcept = default;
 
-    constexpr vector(const DataContainer<T, N>& container) {std::copy(container.data, container.data+N, this->data);}
+    /* Also converts between storage policies. */
+    template <std::size_t P, typename S>
+    constexpr vector(const DataContainer<T, N, P, S>& container) {std::copy(container.data, container.data+N, this->data);}
 
     /* UTILS methods */
     constexpr inline vector& normalize() {
+        MTP_PROFILE_OP(normalize, N, 3*N);
         double length = 0.0f;
         for(size_t i = 0; i < N; i++) length += this->data[i]*this->data[i];
         length = mtp::sqrt<double>(length);
@@ -39,9 +42,10 @@ struct vector : public DataContainer<T, N, Precition> {
 };
 
 /* static methods for vector */
-template<typename T, std::size_t N>
-static constexpr inline vector<T, N> normalize(const vector<T, N> &vec) {
-    vector<T, N> new_container;
+template<typename T, std::size_t N, std::size_t Precition, typename Storage>
+static constexpr inline vector<T, N, Precition, Storage> normalize(const vector<T, N, Precition, Storage> &vec) {
+    MTP_PROFILE_OP(normalize, N, 3*N);
+    vector<T, N, Precition, Storage> new_container;
     double length = 0.0f;
     for(size_t i = 0; i < N; i++) length += vec.data[i]*vec.data[i];
     length = mtp::sqrt<double>(length);
@@ -63,6 +67,18 @@ template <typename T> using vector2 = vector<T, 2>;
 template <typename T> using vector3 = vector<T, 3>;
 template <typename T> using vector4 = vector<T, 4>;
 
+template <typename T, std::size_t N> using packed_vector = vector<T, N, 6, storage_packed>;
+template <typename T, std::size_t N> using aligned_vector = vector<T, N, 6, storage_aligned>;
+
+using vector2f_packed = packed_vector<float, 2>;
+using vector3f_packed = packed_vector<float, 3>;
+using vector3f_aligned = aligned_vector<float, 3>;
+using vector4f_aligned = aligned_vector<float, 4>;
+using vector3d_aligned = aligned_vector<double, 3>;
+
+static_assert(sizeof(vector2f_packed) == 8 && sizeof(vector3f_packed) == 12, "Packed vectors must not be padded.");
+static_assert(sizeof(vector3f_aligned) == 16 && alignof(vector3f_aligned) == 16, "vector3f_aligned must fill one SSE register.");
+
 }
 
 #endif
\ No newline at end of file
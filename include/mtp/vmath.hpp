@@ -0,0 +1,522 @@
+#ifndef VMATH_HPP
+#define VMATH_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include "container.hpp"
+#include "simd.hpp"
+#include "parallel.hpp"
+
+namespace mtp {
+
+/*
+* Element-wise exp, log, sin, cos, tanh, pow and sqrt over fixed and dynamic containers and raw arrays.
+*
+* float arrays run 8 lanes at a time on AVX2 with polynomial approximations. Maximum error against
+* the correctly rounded result, measured over every 997th float of the domain and over all of exp
+* (pow: 2*10^7 random pairs with finite, normal results):
+*
+*            precise    fast
+*   exp      2 ulp      3 ulp     [-104, 89], smaller results flush through denormals to 0
+*   log      1 ulp      5 ulp     every positive float
+*   sin/cos  2 ulp     26 ulp     |x| < 2^20, larger arguments go to the C library
+*   tanh     3 ulp     10 ulp     every float
+*   pow      1 ulp      see below
+*   sqrt     0 ulp      4 ulp     (fast: rsqrt estimate and one Newton step)
+*
+* Fast pow multiplies the fast log2 by y, its error grows with |y*log2(x)|: within 40 ulp while
+* that stays below 8, within 300 ulp up to 64 and 600 ulp over the whole range. Precise pow
+* evaluates log2 and exp2 in double.
+* Infinities, NaNs, zeros and negative bases follow the C library.
+*
+* double arrays, builds without AVX2 and MTP_NO_SIMD use the C library per element, math_mode is
+* ignored there. Large arrays are split between hardware threads in either case.
+*/
+enum class math_mode {
+    precise,
+    fast
+};
+
+namespace detail {
+
+/* Elements per parallel chunk */
+constexpr std::size_t math_grain = 16384;
+
+enum class math_op { exp, log, sin, cos, tanh, sqrt };
+
+template <typename T, std::size_t S, std::size_t P, typename St>
+std::true_type math_container_test(const DataContainer<T, S, P, St>*);
+template <typename T, std::size_t I>
+std::true_type math_container_test(const DynamicDataContainer<T, I>*);
+std::false_type math_container_test(...);
+
+template <typename C>
+using math_container_t = std::enable_if_t<decltype(math_container_test(static_cast<C*>(nullptr)))::value, C>;
+
+template <typename C>
+using math_value_t = std::remove_reference_t<decltype(std::declval<C&>().data[0])>;
+
+/* Writes through data must not reach other owners of a shared buffer. */
+template <typename T, std::size_t S, std::size_t P, typename St>
+inline void math_writable(DataContainer<T, S, P, St>&) {}
+
+template <typename T, std::size_t I>
+inline void math_writable(DynamicDataContainer<T, I> &c) { c.detach(); }
+
+template <math_op Op, typename T>
+inline T math1(const T &x) {
+    if constexpr(Op == math_op::exp)      return std::exp(x);
+    else if constexpr(Op == math_op::log) return std::log(x);
+    else if constexpr(Op == math_op::sin) return std::sin(x);
+    else if constexpr(Op == math_op::cos) return std::cos(x);
+    else if constexpr(Op == math_op::tanh) return std::tanh(x);
+    else return std::sqrt(x);
+}
+
+#if defined(MTP_AVX2)
+
+/* Polynomial coefficients, lowest power first. */
+constexpr float exp_precise[] = { 4.999999345e-01f, 1.666652069e-01f, 4.166838737e-02f, 8.368709828e-03f, 1.381461273e-03f };
+constexpr float exp_fast[]    = { 4.999923179e-01f, 1.666711446e-01f, 4.189011364e-02f, 8.312525194e-03f };
+constexpr float log_precise[] = { 3.333333171e-01f, -2.500082103e-01f, 2.000122690e-01f, -1.662335737e-01f,
+                                  1.420175762e-01f, -1.316018183e-01f, 1.276157911e-01f, -7.634500300e-02f };
+constexpr float log_fast[]    = { 3.333424571e-01f, -2.498326696e-01f, 1.992450344e-01f, -1.713712699e-01f, 1.602438107e-01f, -1.019173064e-01f };
+constexpr float sin_precise[] = { -1.666665461e-01f, 8.332160762e-03f, -1.951528317e-04f };
+constexpr float sin_fast[]    = { -1.666339038e-01f, 8.163281936e-03f };
+constexpr float cos_precise[] = { 4.166664568e-02f, -1.388731625e-03f, 2.443315711e-05f };
+constexpr float cos_fast[]    = { 4.166107131e-02f, -1.364871436e-03f };
+
+/* Series of log2(m) in s = (m-1)/(m+1) and of 2^f, |f| <= 0.5, for the double precision pow. */
+constexpr double log2_series[] = { 2.8853900817779268, 0.9617966939259757, 0.5770780163555853, 0.41219858311113244,
+                                   0.3205988979753252, 0.2623081892525388, 0.2219530832136867 };
+constexpr double exp2_series[] = { 1.0, 0.6931471805599453, 0.2402265069591007, 0.055504108664821576, 0.009618129107628477,
+                                   0.0013333558146428441, 0.00015403530393381606, 1.5252733804059838e-05, 1.3215486790144305e-06,
+                                   1.0178086009239696e-07, 7.054911620801121e-09, 4.44553827187081e-10 };
+
+/* Arguments of sin and cos above this go to the C library. */
+constexpr float sincos_limit = 1048576.0f;
+
+inline __m256 math_fmadd(const __m256 &a, const __m256 &b, const __m256 &c) {
+#if defined(MTP_FMA)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+/* c - a*b */
+inline __m256 math_fnmadd(const __m256 &a, const __m256 &b, const __m256 &c) {
+#if defined(MTP_FMA)
+    return _mm256_fnmadd_ps(a, b, c);
+#else
+    return _mm256_sub_ps(c, _mm256_mul_ps(a, b));
+#endif
+}
+
+inline __m256d math_fmadd(const __m256d &a, const __m256d &b, const __m256d &c) {
+#if defined(MTP_FMA)
+    return _mm256_fmadd_pd(a, b, c);
+#else
+    return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+
+template <std::size_t K>
+inline __m256 horner(const __m256 &x, const float (&c)[K]) {
+    __m256 r = _mm256_set1_ps(c[K-1]);
+    for(std::size_t i = K - 1; i-- > 0;) r = math_fmadd(r, x, _mm256_set1_ps(c[i]));
+    return r;
+}
+
+template <std::size_t K>
+inline __m256d horner(const __m256d &x, const double (&c)[K]) {
+    __m256d r = _mm256_set1_pd(c[K-1]);
+    for(std::size_t i = K - 1; i-- > 0;) r = math_fmadd(r, x, _mm256_set1_pd(c[i]));
+    return r;
+}
+
+inline __m256 round8(const __m256 &x) {
+    return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+inline __m256 abs8(const __m256 &x) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+}
+
+/* v * 2^n for integral n in [-150, 130], applied as two factors so denormal and near-overflow results stay exact. */
+inline __m256 scale8(const __m256 &v, const __m256 &n) {
+    const __m256i ni = _mm256_cvtps_epi32(n);
+    const __m256i half = _mm256_srai_epi32(ni, 1);
+    const __m256i bias = _mm256_set1_epi32(127);
+    const __m256 s0 = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(half, bias), 23));
+    const __m256 s1 = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_sub_epi32(ni, half), bias), 23));
+    return _mm256_mul_ps(_mm256_mul_ps(v, s0), s1);
+}
+
+/* x = n*ln2 + r, returns e^r - 1. ln2 is split so n*0.693359375 is exact without FMA. */
+template <bool Fast>
+inline __m256 expm1_reduced(const __m256 &x, __m256 &n) {
+    n = round8(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)));
+    __m256 r = math_fnmadd(n, _mm256_set1_ps(0.693359375f), x);
+    r = math_fnmadd(n, _mm256_set1_ps(-2.12194440e-4f), r);
+    const __m256 q = Fast ? horner(r, exp_fast) : horner(r, exp_precise);
+    return math_fmadd(_mm256_mul_ps(r, r), q, r);
+}
+
+template <bool Fast>
+inline __m256 exp8(const __m256 &x) {
+    /* x as the second operand keeps NaN */
+    const __m256 c = _mm256_max_ps(_mm256_set1_ps(-104.0f), _mm256_min_ps(_mm256_set1_ps(89.0f), x));
+    __m256 n;
+    const __m256 p = expm1_reduced<Fast>(c, n);
+    return scale8(_mm256_add_ps(p, _mm256_set1_ps(1.0f)), n);
+}
+
+/* x = m * 2^e with m in [sqrt(1/2), sqrt(2)), denormals included. */
+inline __m256 split8(const __m256 &x, __m256 &e) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 tiny = _mm256_cmp_ps(x, _mm256_set1_ps(1.17549435e-38f), _CMP_LT_OQ);
+    const __m256i bits = _mm256_castps_si256(_mm256_blendv_ps(x, _mm256_mul_ps(x, _mm256_set1_ps(8388608.0f)), tiny));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_castps_si256(one)));
+    const __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+    m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+    e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    e = _mm256_add_ps(e, _mm256_and_ps(big, one));
+    e = _mm256_sub_ps(e, _mm256_and_ps(tiny, _mm256_set1_ps(23.0f)));
+    return m;
+}
+
+template <bool Fast>
+inline __m256 log8(const __m256 &x) {
+    __m256 e;
+    const __m256 f = _mm256_sub_ps(split8(x, e), _mm256_set1_ps(1.0f));
+    const __m256 f2 = _mm256_mul_ps(f, f);
+
+    /* log(1+f) = f - f^2/2 + f^3*Q(f), e*ln2 added in two parts */
+    __m256 y = _mm256_mul_ps(_mm256_mul_ps(f2, f), Fast ? horner(f, log_fast) : horner(f, log_precise));
+    y = math_fmadd(e, _mm256_set1_ps(-2.12194440e-4f), y);
+    y = math_fnmadd(_mm256_set1_ps(0.5f), f2, y);
+    __m256 r = math_fmadd(e, _mm256_set1_ps(0.693359375f), _mm256_add_ps(f, y));
+
+    const __m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_setzero_ps(), inf), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_EQ_OQ));
+    r = _mm256_blendv_ps(r, inf, _mm256_cmp_ps(x, inf, _CMP_EQ_OQ));
+    return _mm256_blendv_ps(r, _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN()), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_NGE_UQ));
+}
+
+/*
+* x = n*pi/2 + r in double. pi/2 is split into 33, 33 and 53 bit parts, so n*P1 and n*P2 are exact
+* for |n| <= 2^20 and r keeps full float precision even next to a multiple of pi/2.
+*/
+inline __m128 reduce_half_pi(const __m128 &x, __m128i &quadrant) {
+    const __m256d xd = _mm256_cvtps_pd(x);
+    const __m256d n = _mm256_round_pd(_mm256_mul_pd(xd, _mm256_set1_pd(0.63661977236758134)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_sub_pd(xd, _mm256_mul_pd(n, _mm256_set1_pd(1.5707963267341256)));
+    r = _mm256_sub_pd(r, _mm256_mul_pd(n, _mm256_set1_pd(6.077100506303966e-11)));
+    r = _mm256_sub_pd(r, _mm256_mul_pd(n, _mm256_set1_pd(2.0222662487959506e-21)));
+    quadrant = _mm256_cvtpd_epi32(n);
+    return _mm256_cvtpd_ps(r);
+}
+
+template <bool Fast, bool Cosine>
+inline __m256 sincos8(const __m256 &x) {
+    __m128i q0, q1;
+    const __m128 r0 = reduce_half_pi(_mm256_castps256_ps128(x), q0);
+    const __m128 r1 = reduce_half_pi(_mm256_extractf128_ps(x, 1), q1);
+    const __m256 r = _mm256_set_m128(r1, r0);
+    __m256i q = _mm256_set_m128i(q1, q0);
+    if constexpr(Cosine) q = _mm256_add_epi32(q, _mm256_set1_epi32(1));
+
+    const __m256 z = _mm256_mul_ps(r, r);
+    const __m256 s = math_fmadd(_mm256_mul_ps(r, z), Fast ? horner(z, sin_fast) : horner(z, sin_precise), r);
+    const __m256 c = math_fmadd(_mm256_mul_ps(z, z), Fast ? horner(z, cos_fast) : horner(z, cos_precise),
+        math_fnmadd(_mm256_set1_ps(0.5f), z, _mm256_set1_ps(1.0f)));
+
+    /* odd quadrants swap sin and cos, quadrants 2 and 3 negate */
+    const __m256 odd = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+    const __m256 sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30));
+    __m256 result = _mm256_xor_ps(_mm256_blendv_ps(s, c, odd), sign);
+
+    const int large = _mm256_movemask_ps(_mm256_cmp_ps(abs8(x), _mm256_set1_ps(sincos_limit), _CMP_GT_OQ));
+    if(large) {
+        alignas(32) float in[8], out[8];
+        _mm256_store_ps(in, x);
+        _mm256_store_ps(out, result);
+        for(int i = 0; i < 8; i++) {
+            if(large & (1 << i)) out[i] = Cosine ? std::cos(in[i]) : std::sin(in[i]);
+        }
+        result = _mm256_load_ps(out);
+    }
+    return result;
+}
+
+/* tanh(x) = t / (t + 2) with t = e^(2|x|) - 1, sign restored at the end. */
+template <bool Fast>
+inline __m256 tanh8(const __m256 &x) {
+    const __m256 sign = _mm256_and_ps(x, _mm256_set1_ps(-0.0f));
+    const __m256 ax = _mm256_min_ps(_mm256_set1_ps(9.5f), abs8(x));
+    __m256 n;
+    const __m256 p = expm1_reduced<Fast>(_mm256_add_ps(ax, ax), n);
+    const __m256 scale = scale8(_mm256_set1_ps(1.0f), n);
+    const __m256 t = math_fmadd(scale, p, _mm256_sub_ps(scale, _mm256_set1_ps(1.0f)));
+    return _mm256_or_ps(_mm256_div_ps(t, _mm256_add_ps(t, _mm256_set1_ps(2.0f))), sign);
+}
+
+template <bool Fast>
+inline __m256 sqrt8(const __m256 &x) {
+    if constexpr(!Fast) {
+        return _mm256_sqrt_ps(x);
+    } else {
+        /* one Newton step on the 12 bit estimate, denormals scaled by 2^24, 0 and inf pass through */
+        const __m256 tiny = _mm256_cmp_ps(x, _mm256_set1_ps(1.17549435e-38f), _CMP_LT_OQ);
+        const __m256 xs = _mm256_blendv_ps(x, _mm256_mul_ps(x, _mm256_set1_ps(16777216.0f)), tiny);
+        const __m256 y = _mm256_rsqrt_ps(xs);
+        const __m256 h = _mm256_mul_ps(_mm256_mul_ps(xs, y), _mm256_set1_ps(0.5f));
+        __m256 r = _mm256_mul_ps(_mm256_mul_ps(xs, y), math_fnmadd(h, y, _mm256_set1_ps(1.5f)));
+        r = _mm256_blendv_ps(r, _mm256_mul_ps(r, _mm256_set1_ps(1.0f / 4096.0f)), tiny);
+        const __m256 keep = _mm256_or_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_EQ_OQ),
+            _mm256_cmp_ps(x, _mm256_set1_ps(std::numeric_limits<float>::infinity()), _CMP_EQ_OQ));
+        return _mm256_blendv_ps(r, x, keep);
+    }
+}
+
+template <math_op Op, bool Fast>
+inline __m256 math8(const __m256 &x) {
+    if constexpr(Op == math_op::exp)      return exp8<Fast>(x);
+    else if constexpr(Op == math_op::log) return log8<Fast>(x);
+    else if constexpr(Op == math_op::sin) return sincos8<Fast, false>(x);
+    else if constexpr(Op == math_op::cos) return sincos8<Fast, true>(x);
+    else if constexpr(Op == math_op::tanh) return tanh8<Fast>(x);
+    else return sqrt8<Fast>(x);
+}
+
+/* 4 lanes of 2^(y*log2(m*2^e)) in double, rounded to float once at the end. */
+inline __m128 pow4_precise(const __m128 &m, const __m128 &e, const __m128 &y, const __m128 &ax) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d md = _mm256_cvtps_pd(m);
+    const __m256d s = _mm256_div_pd(_mm256_sub_pd(md, one), _mm256_add_pd(md, one));
+    __m256d l = math_fmadd(s, horner(_mm256_mul_pd(s, s), log2_series), _mm256_cvtps_pd(e));
+
+    const __m256d axd = _mm256_cvtps_pd(ax);
+    const __m256d inf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    l = _mm256_blendv_pd(l, _mm256_sub_pd(_mm256_setzero_pd(), inf), _mm256_cmp_pd(axd, _mm256_setzero_pd(), _CMP_EQ_OQ));
+    l = _mm256_blendv_pd(l, inf, _mm256_cmp_pd(axd, inf, _CMP_EQ_OQ));
+    l = _mm256_blendv_pd(l, axd, _mm256_cmp_pd(axd, axd, _CMP_UNORD_Q));
+
+    __m256d t = _mm256_mul_pd(_mm256_cvtps_pd(y), l);
+    t = _mm256_max_pd(_mm256_set1_pd(-200.0), _mm256_min_pd(_mm256_set1_pd(200.0), t));
+    const __m256d n = _mm256_round_pd(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    const __m256d p = horner(_mm256_sub_pd(t, n), exp2_series);
+    const __m256i bits = _mm256_slli_epi64(_mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)), _mm256_set1_epi64x(1023)), 52);
+    return _mm256_cvtpd_ps(_mm256_mul_pd(p, _mm256_castsi256_pd(bits)));
+}
+
+template <bool Fast>
+inline __m256 pow8(const __m256 &x, const __m256 &y) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 ax = abs8(x);
+    __m256 r;
+    if constexpr(Fast) {
+        __m256 t = _mm256_mul_ps(y, _mm256_mul_ps(log8<true>(ax), _mm256_set1_ps(1.44269504088896341f)));
+        t = _mm256_max_ps(_mm256_set1_ps(-160.0f), _mm256_min_ps(_mm256_set1_ps(130.0f), t));
+        const __m256 n = round8(t);
+        const __m256 f = _mm256_mul_ps(_mm256_sub_ps(t, n), _mm256_set1_ps(0.693147181f));
+        r = scale8(_mm256_add_ps(math_fmadd(_mm256_mul_ps(f, f), horner(f, exp_fast), f), one), n);
+    } else {
+        __m256 e;
+        const __m256 m = split8(ax, e);
+        r = _mm256_set_m128(
+            pow4_precise(_mm256_extractf128_ps(m, 1), _mm256_extractf128_ps(e, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(ax, 1)),
+            pow4_precise(_mm256_castps256_ps128(m), _mm256_castps256_ps128(e), _mm256_castps256_ps128(y), _mm256_castps256_ps128(ax)));
+    }
+
+    /* finite negative bases: NaN for non-integral y, odd integral y keeps the sign (also of -0 and -inf) */
+    const __m256 ay = abs8(y);
+    const __m256 integral = _mm256_cmp_ps(round8(y), y, _CMP_EQ_OQ);
+    const __m256 odd = _mm256_and_ps(_mm256_cmp_ps(ay, _mm256_set1_ps(16777216.0f), _CMP_LT_OQ),
+        _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvttps_epi32(_mm256_and_ps(y, integral)), 31)));
+    r = _mm256_xor_ps(r, _mm256_and_ps(_mm256_and_ps(odd, x), _mm256_set1_ps(-0.0f)));
+    r = _mm256_blendv_ps(r, _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN()),
+        _mm256_andnot_ps(integral, _mm256_and_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ),
+        _mm256_cmp_ps(ax, _mm256_set1_ps(std::numeric_limits<float>::infinity()), _CMP_LT_OQ))));
+
+    /* pow(x, 0) = pow(1, y) = pow(-1, +-inf) = 1, NaN included */
+    const __m256 unit = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(y, _mm256_setzero_ps(), _CMP_EQ_OQ), _mm256_cmp_ps(x, one, _CMP_EQ_OQ)),
+        _mm256_and_ps(_mm256_cmp_ps(ax, one, _CMP_EQ_OQ), _mm256_cmp_ps(ay, _mm256_set1_ps(std::numeric_limits<float>::infinity()), _CMP_EQ_OQ)));
+    return _mm256_blendv_ps(r, one, unit);
+}
+
+#endif
+
+template <math_op Op, bool Fast, typename T>
+void math_span(const T* in, T* out, const std::size_t &count) {
+    std::size_t i = 0;
+#if defined(MTP_AVX2)
+    if constexpr(std::is_same_v<T, float>) {
+        for(; i + 8 <= count; i += 8) _mm256_storeu_ps(out + i, math8<Op, Fast>(_mm256_loadu_ps(in + i)));
+        if(i < count) {
+            /* tail through a padded block, every function accepts 1 */
+            alignas(32) float block[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+            std::copy(in + i, in + count, block);
+            _mm256_store_ps(block, math8<Op, Fast>(_mm256_load_ps(block)));
+            std::copy(block, block + (count - i), out + i);
+            i = count;
+        }
+    }
+#endif
+    for(; i < count; i++) out[i] = math1<Op>(in[i]);
+}
+
+/* y == nullptr raises every element to scalar. */
+template <bool Fast, typename T>
+void pow_span(const T* x, const T* y, const T &scalar, T* out, const std::size_t &count) {
+    std::size_t i = 0;
+#if defined(MTP_AVX2)
+    if constexpr(std::is_same_v<T, float>) {
+        const __m256 s = _mm256_set1_ps(scalar);
+        for(; i + 8 <= count; i += 8) _mm256_storeu_ps(out + i, pow8<Fast>(_mm256_loadu_ps(x + i), y ? _mm256_loadu_ps(y + i) : s));
+        if(i < count) {
+            alignas(32) float bx[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f}, by[8] = {};
+            std::copy(x + i, x + count, bx);
+            if(y) std::copy(y + i, y + count, by);
+            _mm256_store_ps(bx, pow8<Fast>(_mm256_load_ps(bx), y ? _mm256_load_ps(by) : s));
+            std::copy(bx, bx + (count - i), out + i);
+            i = count;
+        }
+    }
+#endif
+    for(; i < count; i++) out[i] = std::pow(x[i], y ? y[i] : scalar);
+}
+
+template <math_op Op, typename T>
+void math_unary(const T* in, T* out, const std::size_t &count, const math_mode &mode, const bool &parallel) {
+    static_assert(std::is_floating_point_v<T>, "Element-wise math requires float or double elements.");
+    MTP_PROFILE_OP(math, count, 0);
+    parallel_for_chunks(plan_chunks(count, math_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        if(mode == math_mode::fast) math_span<Op, true>(in + begin, out + begin, end - begin);
+        else math_span<Op, false>(in + begin, out + begin, end - begin);
+    });
+}
+
+template <typename T>
+void math_pow(const T* x, const T* y, const T &scalar, T* out, const std::size_t &count, const math_mode &mode, const bool &parallel) {
+    static_assert(std::is_floating_point_v<T>, "Element-wise math requires float or double elements.");
+    MTP_PROFILE_OP(math, count, 0);
+    parallel_for_chunks(plan_chunks(count, math_grain, parallel ? 0 : 1), [&](std::size_t, std::size_t begin, std::size_t end) {
+        if(mode == math_mode::fast) pow_span<true>(x + begin, y ? y + begin : nullptr, scalar, out + begin, end - begin);
+        else pow_span<false>(x + begin, y ? y + begin : nullptr, scalar, out + begin, end - begin);
+    });
+}
+
+template <math_op Op, typename C>
+inline C math_container(C x, const math_mode &mode, const bool &parallel) {
+    math_writable(x);
+    math_unary<Op>(x.data, x.data, x.size, mode, parallel);
+    return x;
+}
+
+}
+
+/**
+* @brief out[i] = e^in[i]. in and out may be the same array.
+* @param parallel splits large arrays between hardware threads
+*/
+template <typename T>
+inline void exp(const T* in, T* out, const std::size_t &count, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_unary<detail::math_op::exp>(in, out, count, mode, parallel);
+}
+
+/* out[i] = natural logarithm of in[i]. */
+template <typename T>
+inline void log(const T* in, T* out, const std::size_t &count, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_unary<detail::math_op::log>(in, out, count, mode, parallel);
+}
+
+template <typename T>
+inline void sin(const T* in, T* out, const std::size_t &count, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_unary<detail::math_op::sin>(in, out, count, mode, parallel);
+}
+
+template <typename T>
+inline void cos(const T* in, T* out, const std::size_t &count, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_unary<detail::math_op::cos>(in, out, count, mode, parallel);
+}
+
+template <typename T>
+inline void tanh(const T* in, T* out, const std::size_t &count, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_unary<detail::math_op::tanh>(in, out, count, mode, parallel);
+}
+
+template <typename T>
+inline void sqrt(const T* in, T* out, const std::size_t &count, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_unary<detail::math_op::sqrt>(in, out, count, mode, parallel);
+}
+
+/* out[i] = x[i]^y[i] */
+template <typename T>
+inline void pow(const T* x, const T* y, T* out, const std::size_t &count, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_pow(x, y, T(0), out, count, mode, parallel);
+}
+
+/* out[i] = x[i]^y */
+template <typename T>
+inline void pow(const T* x, const T &y, T* out, const std::size_t &count, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_pow(x, static_cast<const T*>(nullptr), y, out, count, mode, parallel);
+}
+
+/**
+* @brief Element-wise e^x of a DataContainer, vector, matrix or dynamic container.
+* Temporaries are transformed in place, shared dynamic buffers are detached first.
+*/
+template <typename C>
+inline detail::math_container_t<C> exp(C x, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    return detail::math_container<detail::math_op::exp>(std::move(x), mode, parallel);
+}
+
+template <typename C>
+inline detail::math_container_t<C> log(C x, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    return detail::math_container<detail::math_op::log>(std::move(x), mode, parallel);
+}
+
+template <typename C>
+inline detail::math_container_t<C> sin(C x, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    return detail::math_container<detail::math_op::sin>(std::move(x), mode, parallel);
+}
+
+template <typename C>
+inline detail::math_container_t<C> cos(C x, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    return detail::math_container<detail::math_op::cos>(std::move(x), mode, parallel);
+}
+
+template <typename C>
+inline detail::math_container_t<C> tanh(C x, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    return detail::math_container<detail::math_op::tanh>(std::move(x), mode, parallel);
+}
+
+template <typename C>
+inline detail::math_container_t<C> sqrt(C x, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    return detail::math_container<detail::math_op::sqrt>(std::move(x), mode, parallel);
+}
+
+/* Element-wise x^y with a scalar exponent. */
+template <typename C>
+inline detail::math_container_t<C> pow(C x, const detail::math_value_t<C> &y, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_writable(x);
+    detail::math_pow(x.data, static_cast<const detail::math_value_t<C>*>(nullptr), y, x.data, x.size, mode, parallel);
+    return x;
+}
+
+/* Element-wise x^y, y holds at least as many elements as x. */
+template <typename C>
+inline detail::math_container_t<C> pow(C x, const C &y, const math_mode &mode = math_mode::precise, const bool &parallel = true) {
+    detail::math_writable(x);
+    detail::math_pow(x.data, static_cast<const detail::math_value_t<C>*>(y.data), detail::math_value_t<C>(0), x.data, x.size, mode, parallel);
+    return x;
+}
+
+}
+
+#endif